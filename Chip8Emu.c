@@ -1,773 +1,1129 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h> //for unsignted ints
-#define SDL_MAIN_HANDLED
-#include <SDL2/SDL.h> //for graphics and input of the game
-#include <SDL2/SDL_ttf.h> //for drawing text for displaying register etc values next to game
-
-void dumpBinaryToText(const char *inputFile, const char *outputFile) {
-    FILE *in = fopen(inputFile, "rb");
-    if (!in) {
-        printf("Failed to open input file.\n");
-        return;
-    }
-    FILE *out = fopen(outputFile, "w");
-    if (!out) {
-        printf("Failed to open output file.\n");
-        fclose(in);
-        return;
-    }
-
-    int byte, address = 0;
-    while ((byte = fgetc(in)) != EOF) {
-        fprintf(out, "%02X ", (unsigned char)byte);
-        address++;
-        if (address % 16 == 0) fprintf(out, "\n");
-    }
-    fprintf(out, "\n");
-    fclose(in);
-    fclose(out);
-}
-// https://github.com/mattmikolay/chip-8/wiki/CHIP%E2%80%908-Instruction-Set#notes, followed for Original behaviour, quirks are based on behaviour from other sources such as CowGod technical reference for chip8
-int loadStoreRegQuirk = 0; //flag for register I should be incremented by X + 1 (if 0) or not incremented at all (if non 0)                                                       
-int spriteWrapClipQuirk = 0; //flag for if partially drawn sprites wrap around (if 0) or get clipped (non 0), sprites drawn completely 
-int bitShiftQuirk = 0; //flag for if 8XY6 and 8XYE should use register  VX and VY (0) or VX only (non 0)
-
-
-uint8_t mainMemory[4096]; // Main 4096 bytes of memory, each instruction is 2 bytes (16 bits, 2 addresses)
-uint16_t stack[16]; // Stack stores up to 16 return address 
-uint8_t display[64][32]; // Display 64x32 pixels
-uint8_t keys[16]; // Keypad with 16 keys (0x0 to 0xF)
-
-void loadROM(char *nameROM){ //read binary file (chip8 rom, containing instructions) into memory
-    FILE *rom = fopen(nameROM, "rb"); //read file in binary
-    if (rom == NULL) { //make sure rom exists
-        fprintf(stderr, "Failed to open ROM\n");
-        exit(1);
-}
-
-    fseek(rom, 0, SEEK_END); //go to end of file
-    long rom_size = ftell(rom); //get size of file
-    rewind(rom); //put poin ter back to start of file
-
-    if (rom_size > (4096 - 0x200)) { //make sure rom isn't bigger than memory
-        fprintf(stderr, "ROM too large to fit in memory\n");
-        fclose(rom);
-        exit(1);
-    }
-
-    fread(&mainMemory[0x200], 1, rom_size, rom);  //start at address of memory array, read 1 byte at a time, rom size amount of times (each instruction is a byte so size in bytes is no. of instructions), from rom file
-    fclose(rom);
-    
-}
-
-void playSound(){
-    printf("playing sound"); //will add real sound later
-}
-
-int pause = 0; //flag for pausing
-int step = 0; //flag for if step was pressed
-
-void handleKeyPress(SDL_Event *event) {
-    int is_pressed = (event->type == SDL_KEYDOWN) ? 1 : 0; 
-    switch(event->key.keysym.sym) {
-        case SDLK_1: keys[0x1] = is_pressed; break;
-        case SDLK_2: keys[0x2] = is_pressed; break;
-        case SDLK_3: keys[0x3] = is_pressed; break;
-        case SDLK_4: keys[0xC] = is_pressed; break;
-        case SDLK_q: keys[0x4] = is_pressed; break;
-        case SDLK_w: keys[0x5] = is_pressed; break;
-        case SDLK_e: keys[0x6] = is_pressed; break;
-        case SDLK_r: keys[0xD] = is_pressed; break;
-        case SDLK_a: keys[0x7] = is_pressed; break;
-        case SDLK_s: keys[0x8] = is_pressed; break;
-        case SDLK_d: keys[0x9] = is_pressed; break;
-        case SDLK_f: keys[0xE] = is_pressed; break;
-        case SDLK_z: keys[0xA] = is_pressed; break;
-        case SDLK_x: keys[0x0] = is_pressed; break;
-        case SDLK_c: keys[0xB] = is_pressed; break;
-        case SDLK_v: keys[0xF] = is_pressed; break;
-        case SDLK_SPACE:
-            if (is_pressed) pause = !pause; //for pausing  
-            break;
-        case SDLK_n:
-            if (is_pressed && pause) step = 1; //set step to 1 if paused
-            break;
-    }
-}
- 
-typedef struct {
-    uint8_t V[16]; // 16 registers (V0 to VF (0-15), VF is flag register)
-    uint16_t I; // Index register
-    uint8_t DT; // Delay timer  
-    uint8_t ST; // Sound timer
-    uint16_t PC; // Program counter holds address of next instruction in memory unless modified by opcode
-    uint8_t SP; // Stack pointer
-} registers;
-
-registers regs; // global registers
-
-void initialiseSystem() { //set all default values and sprites
-    memset(mainMemory, 0, sizeof(mainMemory));
-    for (int i = 0; i < 16; i++) {
-        regs.V[i] = 0; 
-    }
-    regs.I = 0; 
-    regs.DT = 0; 
-    regs.ST = 0; 
-    regs.PC = 0x200; // Program counter starts at 0x200
-    regs.SP = 0; 
-    for (int i = 0; i < 16; i++) {
-        stack[i] = 0; 
-    }
-    for (int y = 0; y < 32; y++) { //set all display pixels to off
-        for (int x = 0; x < 64; x++) {
-            display[x][y] = 0; 
-        }
-    }
-    for (int i = 0; i < 16; i++) { //set all keys to not pressed
-        keys[i] = 0; 
-    }
-  
-    uint8_t defaultSprites[80] = { // 5x8 sprites for 0-9, A-F, starting at 0x00
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0, top row first, last is bottom row
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, //7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, //8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, //9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-    };
-    for (int i = 0; i < 80; i++) {
-        mainMemory[i] = defaultSprites[i]; // Put sprites into memory 0x00 to 0x4F
-    }
-}
-
-void op_00E0() { // clear display array
-    for (int i = 0; i < 64; i++) {
-        for (int j = 0; j < 32; j++) {
-            display[i][j] = 0;
-        }
-    }
-}
-
-void op_00EE() { // return from subroutine
-    if (regs.SP > 0) {
-        regs.PC = stack[--regs.SP]; //decrement SP by 1 and set PC
-    } else {
-        printf("Stack underflow\n");
-    }
-}
-
-void op_0NNN(uint16_t NNN) {
-    printf("Opcode not implemented\n"); //idk what this is?
-}
-
-void op_1NNN(uint16_t NNN) { // jump to address NNN
-    regs.PC = NNN; // set PC to NNN
-}
-
-void op_2NNN(uint16_t NNN) { // call subroutine at NNN
-    if (regs.SP < 15) {
-        stack[regs.SP++] = regs.PC; // push current PC onto stack and increment SP
-        regs.PC = NNN; // set PC to NNN
-    } else {
-        printf("Stack overflow\n");
-    }
-}
-
-void op_3XNN(uint8_t X, uint8_t NN) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X equals NN
-    if (regs.V[X] == NN) {
-        regs.PC += 2; 
-    }
-}
-
-void op_4XNN(uint8_t X, uint8_t NN) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X does not equal NN
-    if (regs.V[X] != NN) {
-        regs.PC += 2;
-    }
-}
-
-void op_5XY0(uint8_t X, uint8_t Y) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X equals register Y
-    if (regs.V[X] == regs.V[Y]) {
-        regs.PC += 2;
-    }
-}
-
-void op_6XNN(uint8_t X, uint8_t NN) { //set register X to NN
-    regs.V[X] = NN;
-}
-
-void op_7XNN(uint8_t X, uint8_t NN) { //add NN to register X, C overflow matches Chip-8 spec for register overflow (Modulo 256 for values larger than 255)
-    regs.V[X] += NN;
-}
-
-void op_8XY0(uint8_t X, uint8_t Y) { //set register X to register Y
-    regs.V[X] = regs.V[Y];
-}
-
-void op_8XY1(uint8_t X, uint8_t Y) { //set register X to register X OR register Y
-    regs.V[X] |= regs.V[Y];
-}
-
-void op_8XY2(uint8_t X, uint8_t Y) { //set register X to register X AND register Y
-    regs.V[X] &= regs.V[Y];
-}
-
-void op_8XY3(uint8_t X, uint8_t Y) { //set register X to register X XOR register Y
-    regs.V[X] ^= regs.V[Y];
-}
-
-void op_8XY4(uint8_t X, uint8_t Y) { //add register Y to register X, set VF to 1 if overflow, 0 if not, do flag first then register or leads to bugs
-    uint16_t sum = regs.V[X] + regs.V[Y];
-    if (sum > 255) {
-        regs.V[0xF] = 1; //1 for overflow
-    } else {
-        regs.V[0xF] = 0; //0 for no overflow
-    }
-    regs.V[X] = regs.V[X] + regs.V[Y]; //C does wrap around if overflow occurs, could also mask sum with 0xFF or sum mod 256
-}
-
-void op_8XY5(uint8_t X, uint8_t Y) { //subtract register Y from register X, set VF to 1 if no borrow, 0 if borrow
-    if (regs.V[X] > regs.V[Y]) {
-        regs.V[0xF] = 1; //no borrow
-    } else {
-        regs.V[0xF] = 0; //borrow
-    }
-    regs.V[X] -= regs.V[Y];
-}
-
-void op_8XY6(uint8_t X, uint8_t Y) { //based on if bitShiftQuirk set to 0 or non 0
-    if (bitShiftQuirk == 0) { //register X = register Y >> 1, set VF to least significant bit of register Y, bitShiftQuirk= 0
-        regs.V[0xF] = regs.V[Y] & 0x01; //set VF to least significant bit of VY
-        regs.V[X] = regs.V[Y] >> 1; //set VX to VY shifted right by 1
-    }
-    else { //register X = register X >> 1, set VF to least significant bit of register X, bitShiftQuirk = non 0
-        regs.V[0xF] = regs.V[X] & 0x01; //set VF to least significant bit of VX
-        regs.V[X] = regs.V[X] >> 1; //set VX to VX shifted right by 1
-    }
-}
-
-void op_8XY7(uint8_t X, uint8_t Y) { //set register X to register Y - register X, set VF to 1 if no borrow, 0 if borrow
-    if (regs.V[Y] > regs.V[X]) {
-        regs.V[0xF] = 1; //no borrow
-    } else {
-        regs.V[0xF] = 0; //borrow
-    }
-    regs.V[X] = regs.V[Y] - regs.V[X];
-}
-
-void op_8XYE(uint8_t X, uint8_t Y) { //based on if bitShiftQuirk set to 0 or non 0
-    if(bitShiftQuirk == 0){ //register X = register Y << 1, set VF to most significant bit of register Y, bitShiftQuirk - 0
-        regs.V[0xF] = regs.V[Y] >> 7; //set VF to most significant bit of VY
-        regs.V[X] = regs.V[Y] << 1; //set VX to VY shift left by 1
-    }
-    else{ //register X = register X << 1, set VF to most significant bit of register X, bitShiftQuirk = non 0
-        regs.V[0xF] = regs.V[X] >> 7; //set VF to most significant bit of VX
-        regs.V[X] = regs.V[X] << 1; //shift VX left by 1
-    }
-}
-
-void op_9XY0(uint8_t X, uint8_t Y) { //skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X does not equal register Y
-    if (regs.V[X] != regs.V[Y]) {
-        regs.PC += 2;
-    }
-}
-
-void op_ANNN(uint16_t NNN) { //set index register I to NNN
-    regs.I = NNN;
-}
-
-void op_BNNN(uint16_t NNN) { // jump to address NNN + V0
-    regs.PC = NNN + regs.V[0];
-}
-
-void op_CXNN(uint8_t X, uint8_t NN) { //set register X to random number AND NN
-    uint8_t randomByte = rand() % 256; // Generate a random byte (0-255)
-    regs.V[X] = randomByte & NN; // AND with NN
-}
-
-void op_DXYN(uint8_t X, uint8_t Y, uint8_t N) { // draw sprite from address I at (V[X], V[Y] corresponding to top left most pixel) with height N(top level, top level - N) 
-    regs.V[0xF] = 0; //set register VF to 0 initially when no collision
-    //first bit always on screen somewhere
-    int firstX = regs.V[X] % 64; //wraparound X if needed for initial X coord
-    int firstY = regs.V[Y] % 32; //wraparound Y if needed for initial Y coord
-
-    for(int i = 0; i < N; i++){ //get each row of the sprite down to height top - N (sprites starts at lowest address)
-        uint8_t spriteRow = mainMemory[regs.I + i]; //get row of bits for that column
-
-        //non first bits either wrapped around or clipped depending on spriteWrapClipQuirk value
-        for(int j = 0; j <= 7; j++ ){
-            int currentX = firstX + j;
-            int currentY = firstY + i;
-
-            if(spriteWrapClipQuirk != 0 && (currentX > 63 || currentY > 31) && (j != 0 || i != 0)){ //clip sprite if spriteWrapClipQuirk != 0
-                continue; //do nothing since clipped
-            }
-            //if pixel doesn't clip or clip quirk = 0
-            currentX = (firstX + j) % 64; //wraparound if needed 
-            currentY = (firstY + i) % 32; //wraparound if needed
-            uint8_t mask = 128 >> j; //mask to find each indiviual bit from byte row
-            uint8_t bit = (spriteRow & mask) >> (7-j); //value of each bit at specific position in the byte (starting from leftmost bit)
-            if (bit == 1 && display[currentX][currentY] == 1){ //check if value would cause collision ie both bits result in 0 when XOR so when both bits 1 before the XOR
-                regs.V[0xF] = 1;
-            }
-            display[currentX][currentY] ^= bit; //current display bit XOR with new bit and update display with result
-            // DOUBLE CHECK SPEC: VF collision flag set before pixel is XOR'ed, to see if that's correct order
-        }
-
-    }
-} 
-   
-void op_EX9E(uint8_t X) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if key with value of register X is pressed
-    if (keys[regs.V[X]] == 1) { //key pressed if value is 1
-        regs.PC += 2;
-    }
-}
-
-void op_EXA1(uint8_t X) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if key with value of register X is not pressed
-    if (keys[regs.V[X]] == 0) { //key not pressed if value is 0
-        regs.PC += 2;
-    }
-}
-
-void op_FX07(uint8_t X) { // set register X to value of delay timer
-    regs.V[X] = regs.DT;
-}
-
-void op_FX0A(uint8_t X) { // wait for key press and set register X to value of pressed key
-    int keyPressed = 0;
-    for (int i = 0; i < 16; i++) {
-        if (keys[i] == 1) {
-            regs.V[X] = i; // set register X to pressed key
-            keyPressed = 1;
-            break; //inconsistent if multiple keys pressed, not sure how to handle this?
-        }
-    }
-    if (keyPressed == 0) {
-        regs.PC -= 2; // if no key pressed, decrement PC so instruction repeats
-    }
-}
-
-void op_FX15(uint8_t X) { // set delay timer to value of register X
-    regs.DT = regs.V[X];
-}
-
-void op_FX18(uint8_t X) { // set sound timer to value of register X
-    regs.ST = regs.V[X];
-}
-
-void op_FX1E(uint8_t X) { // add value of register X to index register I
-    regs.I += regs.V[X]; //value x mod 4096 since 16bit register
-}      
-
-void op_FX29(uint8_t X) { // set index register I to location of sprite for digit in register X
-    if (regs.V[X] < 16) { // ensure X is a valid digit (0-15)
-        regs.I = regs.V[X] * 5; // sprites are 5 bytes from 0x00 to 0x4F
-    } else {
-        printf("Invalid digit in register V[%d]: %d\n", X, regs.V[X]);
-    }
-}
-
-void op_FX33(uint8_t X) { // store BCD representation of value in register X at I, I+1, I+2
-    uint8_t value = regs.V[X];
-    mainMemory[regs.I] = value / 100; // integer division for 100 digit
-    mainMemory[regs.I + 2] = value % 10; // one digit
-    mainMemory[regs.I + 1] = (value - (mainMemory[regs.I] * 100) - mainMemory[regs.I + 2]) / 10; // tens digit
-}
-
-void op_FX55(uint8_t X) { // store registers V0 to VX inclusive in memory starting at address I
-    for (int i = 0; i <= X; i++) {
-        mainMemory[regs.I + i] = regs.V[i];
-    }
-    if(loadStoreRegQuirk == 0){
-        regs.I += X + 1; // increment I by X + 1 after
-    } //if loadStoreRegQuirk == 0 then set reg I to I+X+1 after, otherwise reg I stays the same after the instruction if loadStoreRegQuirk == non 0
-}
-
-void op_FX65(uint8_t X) { // read registers V0 to VX inclusive from memory starting at address I
-    for (int i = 0; i <= X; i++) {
-        regs.V[i] = mainMemory[regs.I + i];
-    }
-    if(loadStoreRegQuirk == 0){
-        regs.I += X + 1; // increment I by X + 1 after
-    } //if loadStoreRegQuirk == 0 then set reg I to I+X+1 after, otherwise reg I stays the same after the instruction if loadStoreRegQuirk == non 0
-
-}
-
-void decode(uint16_t opcode) {
-    uint8_t firstFourBits = opcode >> 12;
-    uint16_t NNN = opcode & 0x0FFF; // Extract NNN
-    uint8_t NN = opcode & 0x00FF; // Extract NN
-    uint8_t N = opcode & 0x000F; // Extract N
-    uint8_t X = (opcode & 0x0F00) >> 8; // Extract X
-    uint8_t Y = (opcode & 0x00F0) >> 4; // Extract Y
-    
-    switch (firstFourBits) {
-        case 0x0: {
-            if (opcode == 0x00E0) {
-                op_00E0();
-            } else if (opcode == 0x00EE) {
-                op_00EE();
-            } else {
-                op_0NNN(NNN);
-            }
-            break;
-        }
-        case 0x1: {
-            op_1NNN(NNN);
-            break;
-        }
-        case 0x2: {
-            op_2NNN(NNN);
-            break;
-        }
-        case 0x3: {
-            op_3XNN(X,NN);
-            break;
-        }
-        case 0x4: {
-            op_4XNN(X,NN);
-            break;
-        }
-        case 0x5: {
-            if (N == 0) op_5XY0(X, Y);
-            else printf("Unknown opcode: 0x%04X\n", opcode);
-            break;
-        }
-        case 0x6: {
-            op_6XNN(X, NN);
-            break;
-        }
-        case 0x7: {
-            op_7XNN(X, NN);
-            break;
-        }
-        case 0x8: {
-            if (N == 0) {
-                op_8XY0(X, Y);
-            }
-            else if (N == 1) {
-                op_8XY1(X, Y);
-            } else if (N == 2) {
-                op_8XY2(X, Y);
-            } else if (N == 3) {
-                op_8XY3(X, Y);
-            } else if (N == 4) {
-                op_8XY4(X, Y);
-            } else if (N == 5) {
-                op_8XY5(X, Y);
-            } else if (N == 6) { //bitShiftQuirk handled inside actual instruction
-                op_8XY6(X,Y);
-            } else if (N == 7) {
-                op_8XY7(X, Y);
-            } else if (N == 0xE) { //bitShiftQuirk handled inside actual instruction
-                op_8XYE(X, Y);
-            } else {
-                printf("Unknown opcode: 0x%04X\n", opcode);
-            }
-            break;
-        }
-        case 0x9: {
-            if (N == 0) op_9XY0(X, Y);
-            else printf("Unknown opcode: 0x%04X\n", opcode);
-            break;
-        }
-        case 0xA: {
-            op_ANNN(NNN);
-            break;
-        }   
-        case 0xB: {
-            op_BNNN(NNN);
-            break;
-        }
-        case 0xC: {
-            op_CXNN(X, NN);
-            break;
-        }
-        case 0xD: {
-            op_DXYN(X, Y, N); // clip or wrap Quirk handled in instruction
-            break;
-        }
-        case 0xE: {
-            if (NN == 0x9E) {
-                op_EX9E(X);
-            } else if (NN == 0xA1) {
-                op_EXA1(X);
-            } else {
-                printf("Unknown opcode: 0x%04X\n", opcode);
-            }
-            break;
-        }
-        case 0xF: {
-            if (NN == 0x07) {
-                op_FX07(X);
-            } else if (NN == 0x0A) {
-                op_FX0A(X);
-            } else if (NN == 0x15) {
-                op_FX15(X);
-            } else if (NN == 0x18) {
-                op_FX18(X);
-            } else if (NN == 0x1E) {
-                op_FX1E(X);
-            } else if (NN == 0x29) {
-                op_FX29(X);
-            } else if (NN == 0x33) {
-                op_FX33(X);
-            } else if (NN == 0x55) { //loadStoreRegQuirk handled inside instruction
-                op_FX55(X);
-            } else if (NN == 0x65) { //loadStoreRegQuirk handled inside instruction
-                op_FX65(X);
-            } else {
-                printf("Unknown opcode: 0x%04X\n", opcode);
-            }
-            break;
-        }
-        default: {
-            printf("Unknown opcode: 0x%04X\n", opcode);
-            break;
-        }
-    }
-}
-
-uint16_t lastInstruction = 0; //for tracking last instruction 
-
-void fetchDecodeExecute(){
-    uint16_t instruction = (mainMemory[regs.PC] << 8) | mainMemory[regs.PC + 1]; //fetch each 8 bit half of instruction and concatanate, big Endian for instructions
-    lastInstruction = instruction; // store current instruction
-    regs.PC += 2; //set PC to next sequential instruction, executed instruction can change this potentially
-    decode(instruction); //decode into opcode and operand and execute
-}
-
-void drawDisplay(SDL_Renderer *renderer){
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); //black pixels
-    SDL_RenderClear(renderer); //turn screen to black
-
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); //white pixels
-    for (int y = 0; y < 32; y++) { //width 32 pixels, loop through display array and set white pixels when == 1
-        for (int x = 0; x < 64; x++) { //height 64 pixels
-            if (display[x][y] == 1) { //if display array set to 1 at that position, draw a white square (pixel) there
-                SDL_Rect rect = { x * 10, y * 10, 10, 10 }; //pixels are 10x10 window pixels squares
-                SDL_RenderFillRect(renderer, &rect);
-            }
-        }
-    }
-}
-
-void drawText(SDL_Renderer *renderer, TTF_Font *font, int x, int y, const char *text, SDL_Color color) { //drawing text on screen
-    SDL_Surface *surface = TTF_RenderText_Solid(font, text, color);
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_Rect dst = { x, y, surface->w, surface->h };
-    SDL_RenderCopy(renderer, texture, NULL, &dst);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
-}
-
-int drawCheckbox(SDL_Renderer *renderer, int x, int y, int checked, int mouseX, int mouseY, int mouseDown) {
-    SDL_Rect box = {x, y, 16, 16};
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderDrawRect(renderer, &box);
-    if (checked) {
-        SDL_SetRenderDrawColor(renderer, 0, 200, 0, 255);
-        SDL_Rect fill = {x+3, y+3, 10, 10};
-        SDL_RenderFillRect(renderer, &fill);
-    }
-    // If mouse is down and inside box, return 1
-    if (mouseDown && mouseX >= x && mouseX <= x+16 && mouseY >= y && mouseY <= y+16)
-        return 1;
-    return 0;
-}
-
-int drawButton(SDL_Renderer *renderer, int x, int y, int w, int h, const char *label, int mouseX, int mouseY, int mouseDown, TTF_Font *font) {
-    SDL_SetRenderDrawColor(renderer, 70, 70, 200, 255);
-    SDL_Rect rect = {x, y, w, h};
-    SDL_RenderFillRect(renderer, &rect);
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderDrawRect(renderer, &rect);
-    drawText(renderer, font, x + 10, y + 5, label, (SDL_Color){255,255,255,255});
-    if (mouseDown && mouseX >= x && mouseX <= x+w && mouseY >= y && mouseY <= y+h)
-        return 1;
-    return 0;
-}
-
-void drawMemoryHex(SDL_Renderer *renderer, TTF_Font *font) {
-    SDL_Color gray = {180, 180, 180, 255};
-    char line[64];
-    int lines = 32; // mumber of lines to show 
-    int bytesPerLine = 8; // how many bytes shown on every line
-
-    for (int i = 0; i < lines; i++) {
-        int addr = 0x200 + i * bytesPerLine;
-        if (addr >= 4096) break;
-        int len = snprintf(line, sizeof(line), "%03X: ", addr);
-        for (int j = 0; j < bytesPerLine && (addr + j) < 4096; j++) {
-            len += snprintf(line + len, sizeof(line) - len, "%02X ", mainMemory[addr + j]);
-        }
-        drawText(renderer, font, 10, 10 + i * 18, line, gray);
-    }
-}
-
-int main(int argc, char *argv[]){ //for SDL
-    dumpBinaryToText("Play.ch8", "Play_dump.txt"); //view game binary
-    initialiseSystem(); //initalise memory/registers etc
-    loadROM("Play.ch8"); //loads rom Play.ch8 into memory
-
-    SDL_Init(SDL_INIT_VIDEO); //for SDL TTF errors
-    if (TTF_Init() == -1) {
-    printf("TTF_Init: %s\n", TTF_GetError());
-    exit(1);
-    }
-    TTF_Font *font = TTF_OpenFont("arial.ttf", 16); //need arial.ttf in same folder
-    if (!font) {
-        printf("Failed to load font: %s\n", TTF_GetError());
-        exit(1);
-    }
-    SDL_Window *window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 900, 560, 0); //window width and height 640x320, 10x10 window to chip8 pixel
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED); //default driver gpu accelerated if possible
-
-    uint32_t last_time = SDL_GetTicks(); //initalise time since SDL library initialised
-    uint32_t timer_accumulator = 0; //initialise timer to track real time between loops
-
-    SDL_Event event; //stores input/quit events
-    int IPF = 10;
-    int open = 1;
-    while (open) {
-        while (SDL_PollEvent(&event)) { //Check if user quit or not
-            if (event.type == SDL_QUIT) open = 0; //SDL_QUIT is close window button
-            handleKeyPress(&event); // check user input and update keys array accordingly 
-        }
-
-        for (int i = 0; i < IPF; i++) { //how many chip8 instructions happen per frame, controlled by IPF value set
-            if (!pause || step) {
-                fetchDecodeExecute();
-                if (pause) {
-                    step = 0; // set step back to 0 and break loop so only one instruction executed
-                    break;  
-        }
-            }
-        }
-
-        uint32_t now = SDL_GetTicks(); //current time
-        timer_accumulator += now - last_time; //amount of time since last time, keeps adding on to know how many times to decrement timer e.g. 35 ms elapsed since last loop then 35 > 16.67 * 2 so decrement timers twice
-        last_time = now; //update last time for next loop
-        while (timer_accumulator >= 1000 / 60) { //1000/60 = 16 ms (60fps roughly)  once 16 or greater elapsed since last frame then decrement timers
-            if (!pause) { // only decrement timers if not paused
-                if (regs.DT > 0) regs.DT--; //decrement delay timer by 1
-                if (regs.ST > 0){ 
-                    regs.ST--; // decrement sound timer by 1
-                    playSound(); //not actually implemented yet
-                }
-            } //sub frame timing isn't preserved when pausing, fix later maybe?
-            timer_accumulator -= 1000 / 60; //remove 16.67ms from accumulator since timers have been decremented for that time period
-    }
-
-        // 4. Render display
-        drawDisplay(renderer);
-        // drawMemoryHex(renderer, font); //Showing ROM instructions in hex (disabled for now, too long)
-
-        SDL_Color white = {255,255,255,255};
-
-        drawText(renderer, font, 300, 520, "Pause: spc Step: n", white);
-        if (pause) { //show paused if paused
-            drawText(renderer, font, 570, 520, "PAUSED", white);
-}
-        char buf[128];
-
-        // Registers
-        for (int i = 0; i < 16; i++) {
-            sprintf(buf, "V%X: %02X", i, regs.V[i]); //put register values into buf char array and then put on screen using drawText
-            drawText(renderer, font, 650, 10 + i * 20, buf, white);
-        }
-        sprintf(buf, "I: %04X", regs.I); drawText(renderer, font, 650, 340, buf, white);
-        sprintf(buf, "PC: %04X", regs.PC); drawText(renderer, font, 650, 360, buf, white);
-        sprintf(buf, "SP: %02X", regs.SP); drawText(renderer, font, 650, 380, buf, white);
-        sprintf(buf, "DT: %02X", regs.DT); drawText(renderer, font, 650, 400, buf, white);
-        sprintf(buf, "ST: %02X", regs.ST); drawText(renderer, font, 650, 420, buf, white);
-
-        //Last Instruction
-        sprintf(buf, "Instr: %04X", lastInstruction); 
-        drawText(renderer, font, 650, 440, buf, white);
-
-        //IPF
-        sprintf(buf, "IPF: %d", IPF); 
-        drawText(renderer, font, 500, 440, buf, white);
-
-        // Stack
-        for (int i = 0; i < 16; i++) {
-            sprintf(buf, "S%X: %04X", i, stack[i]);
-            drawText(renderer, font, 750, 10 + i * 20, buf, white);
-        }
-
-        // Keys
-        for (int i = 0; i < 16; i++) {
-            sprintf(buf, "K%X: %d", i, keys[i]);
-            drawText(renderer, font, 850, 10 + i * 20, buf, white);
-        }
-
-        // Quirk flags
-        sprintf(buf, "loadStoreRegQuirk: %d", loadStoreRegQuirk);
-        drawText(renderer, font, 650, 460, buf, white);
-        sprintf(buf, "spriteWrapClipQuirk: %d", spriteWrapClipQuirk);
-        drawText(renderer, font, 650, 480, buf, white);
-        sprintf(buf, "bitShiftQuirk: %d", bitShiftQuirk);
-        drawText(renderer, font, 650, 500, buf, white);
-
-        // Get mouse state
-        int mouseX, mouseY;
-        Uint32 mouseState = SDL_GetMouseState(&mouseX, &mouseY);
-        int mouseDown = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
-
-        // Draw checkboxes and toggle quirks if clicked
-        if (drawCheckbox(renderer, 820, 460, loadStoreRegQuirk, mouseX, mouseY, mouseDown)) {
-            loadStoreRegQuirk = !loadStoreRegQuirk;
-        }
-        if (drawCheckbox(renderer, 820, 480, spriteWrapClipQuirk, mouseX, mouseY, mouseDown)) {
-            spriteWrapClipQuirk = !spriteWrapClipQuirk;
-        }
-        if (drawCheckbox(renderer, 820, 500, bitShiftQuirk, mouseX, mouseY, mouseDown)) {
-            bitShiftQuirk = !bitShiftQuirk;
-        }
-
-        // Draw "Load ROM" button
-        if (drawButton(renderer, 650, 520, 120, 30, "Load ROM", mouseX, mouseY, mouseDown, font)) {
-            char filename[256]; //for storing filename
-            printf("Enter ROM filename: ");
-            fflush(stdout);
-            if (scanf("%255s", filename) == 1) { //read string up to 255 bytes, put into filename array if it read a string (==1) then try load the rom
-                initialiseSystem();
-                loadROM(filename);
-            }
-        }
-
-        // Draw "IPF" button
-        if (drawButton(renderer, 450, 520, 120, 30, "IPF", mouseX, mouseY, mouseDown, font)) {
-            printf("Enter an integer for IPF (default 10 at 60fps): ");
-            fflush(stdout); // Ensure prompt is shown before input
-            if (scanf("%d", &IPF) == 1) {
-                printf("You entered: %d\n", IPF); //currently not guarded for invalid input, fix later
-            } else {
-                printf("Invalid input!\n");
-            }
-        }
-
-        
-        SDL_RenderPresent(renderer); //update window with everything drawn since renderclear (white pixel)
-
-        SDL_Delay(1000/63); //60 fps (made slightly higher since a lot of overhead due to drawing many things now)
-
-    }
-
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-    return 0;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h> //for unsignted ints
+#include <ctype.h> //toupper, opcode class names in break commands
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h> //for graphics and input of the game
+#include <SDL2/SDL_ttf.h> //for drawing text for displaying register etc values next to game
+#include "chip8.h" //emulator core, no SDL in there
+#include "render.h" //display texture and overlay text
+#include "snapshot.h" //save states and rewind
+#ifdef CHIP8_TRACE
+#include "trace.h" //T starts and stops an instruction trace
+#endif
+#ifdef CHIP8_PROFILE
+#include "profile.h" //P starts and stops the guest profiler
+#endif
+#include "lockfree.h" //queue and triple buffer between the emulation thread and the SDL thread
+#include "audio.h" //square wave while the sound timer runs
+#include "romdb.h" //per rom quirks, rate and code analysis, keyed by hash
+#include "record.h" //input recording for replay
+#include "control.h" //text commands from the console and --control socket
+#include "stream.h" //--stream, display out to remote viewers and their keys in
+
+void dumpBinaryToText(const char *inputFile, const char *outputFile) {
+    FILE *in = fopen(inputFile, "rb");
+    if (!in) {
+        printf("Failed to open input file.\n");
+        return;
+    }
+    FILE *out = fopen(outputFile, "w");
+    if (!out) {
+        printf("Failed to open output file.\n");
+        fclose(in);
+        return;
+    }
+
+    int byte, address = 0;
+    while ((byte = fgetc(in)) != EOF) {
+        fprintf(out, "%02X ", (unsigned char)byte);
+        address++;
+        if (address % 16 == 0) fprintf(out, "\n");
+    }
+    fprintf(out, "\n");
+    fclose(in);
+    fclose(out);
+}
+
+static int readROM(const char *nameROM, uint8_t *buffer, size_t *size){ //read binary file (chip8 rom, containing instructions) into buffer (CHIP8_MAX_ROM_SIZE + 1 bytes), returns 0 on success, -1 after saying why
+    FILE *rom = fopen(nameROM, "rb"); //read file in binary
+    if (rom == NULL) { //make sure rom exists
+        fprintf(stderr, "Failed to open ROM %s\n", nameROM);
+        return -1;
+    }
+    *size = fread(buffer, 1, CHIP8_MAX_ROM_SIZE + 1, rom);  //one extra byte so too large roms can be detected, returns how many bytes actually read
+    fclose(rom);
+
+    if (*size > CHIP8_MAX_ROM_SIZE) { //make sure rom isn't bigger than memory
+        fprintf(stderr, "ROM %s too large to fit in memory\n", nameROM);
+        return -1;
+    }
+    return 0;
+}
+
+size_t loadROM(chip8 *c8, char *nameROM){ //read a rom into memory at startup, there's nothing to fall back to so failing exits, returns its size
+    uint8_t buffer[CHIP8_MAX_ROM_SIZE + 1];
+    size_t rom_size;
+    if (readROM(nameROM, buffer, &rom_size) != 0) {
+        exit(1);
+    }
+    loadROMBuffer(c8, buffer, rom_size);
+    return rom_size;
+}
+
+
+typedef struct { //running mean, standard deviation and max of a time in ms
+    long long count;
+    double mean;
+    double m2; //sum of squared differences from the mean, Welford's method so it doesn't lose precision over long runs
+    double max;
+} timingStats;
+
+static void addTiming(timingStats *t, double ms) {
+    t->count++;
+    double delta = ms - t->mean;
+    t->mean += delta / t->count;
+    t->m2 += delta * (ms - t->mean);
+    if (ms > t->max) t->max = ms;
+}
+
+static double timingStdDev(const timingStats *t) {
+    return t->count > 1 ? SDL_sqrt(t->m2 / (t->count - 1)) : 0.0;
+}
+
+// Paces the emulation thread off the high resolution performance counter.
+// Time owed is kept as integer remainders of counter ticks so nothing drifts, timers tick exactly 60 times a second
+// and instructions run at exactly instructionHz, worked out in order between the timer ticks so they're spread evenly through each frame.
+typedef struct {
+    uint64_t frequency; //performance counter ticks per second
+    uint64_t last; //counter when we last caught up
+    uint64_t timerRemainder; //counter ticks * 60 since the last timer tick, next tick is due when it reaches frequency
+    uint64_t instructionRemainder; //counter ticks * rate not yet run as whole instructions
+    timingStats tickLateness; //how long after it was due each timer tick actually ran
+} scheduler;
+
+// The emulation runs on its own thread so rendering can't slow it down or skew the timers.
+// The SDL thread sends it commands (keys, pause, quirk toggles etc) through an SPSC queue,
+// and it sends back a copy of everything the overlay shows through a triple buffer after every frame it runs.
+typedef enum {
+    CMD_KEY, //value is the chip8 key, pressed is 1 or 0
+    CMD_PAUSE, //value is 1 to pause, 0 to resume, -1 to toggle
+    CMD_STEP, //run one instruction if paused
+    CMD_TOGGLE_QUIRK, //value is 0 loadStoreRegQuirk, 1 spriteWrapClipQuirk, 2 bitShiftQuirk
+    CMD_SET_QUIRK, //value as CMD_TOGGLE_QUIRK, pressed is the new setting
+    CMD_LOAD_ROM, //reset and load filename
+    CMD_SET_RATE, //value is the new instruction rate in Hz
+    CMD_TURBO, //pressed is 1 while the turbo key is held
+    CMD_REWIND, //pressed is 1 while the rewind key is held
+    CMD_SAVE_STATE, //save a snapshot to filename
+    CMD_LOAD_STATE, //load a snapshot from filename
+    CMD_TRACE, //start or stop tracing to filename, only in -DCHIP8_TRACE builds
+    CMD_RECORD, //start or stop recording input to filename
+    CMD_PROFILE, //start or stop profiling, only in -DCHIP8_PROFILE builds
+    CMD_DEBUG //break or watch command, the whole line is in filename
+} commandType;
+
+typedef struct {
+    commandType type;
+    int value;
+    int pressed;
+    char filename[256];
+} emuCommand;
+
+typedef struct { //what the renderer gets to see of the machine
+    uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS];
+    int hires;
+    uint32_t displayGeneration; //the machine's displayGeneration when display was copied
+    registers regs;
+    uint16_t stack[16];
+    uint8_t keys[16];
+    uint16_t lastInstruction;
+    int loadStoreRegQuirk;
+    int spriteWrapClipQuirk;
+    int bitShiftQuirk;
+    int instructionHz;
+    int turboActive;
+    int rewinding;
+    int rewindFrames; //how far back rewind can go
+    size_t rewindBytes;
+    int paused;
+    int waitingForKey; //stopped on FX0A
+    int recording;
+    timingStats tickLateness;
+} frameSnapshot;
+
+#define COMMAND_QUEUE_SIZE 64 //power of two
+#define QUICKSAVE_FILE "quicksave.c8s" //F5 saves here, F9 loads it
+#define TRACE_FILE "trace.c8t" //T traces here, read it with tracedump
+#define RECORD_FILE "recording.c8r" //F7 records here, play it back with replay
+#define PROFILE_REPORT_FILE "profile.txt" //P writes these when profiling stops
+#define PROFILE_FOLDED_FILE "profile.folded"
+#define REWIND_ARENA_SIZE (256 * 1024) //deltas are tens of bytes a frame, plenty for REWIND_MAX_FRAMES
+#define OVERLAY_REFRESH_MS 100 //registers, stack and keys change nearly every frame while running, redraw for them at most 10 times a second
+
+typedef struct {
+    chip8 *c8; //only touched by the emulation thread once it's started
+    int instructionHz; //instructions per second, 600 by default (the old 10 per frame)
+    int turbo; //instruction rate multiplier while the turbo key is held, 0 for uncapped
+    int turboHeld;
+    int rewinding; //rewind key held, step back a frame every 60hz tick instead of running
+    int paused;
+    scheduler sched;
+    rewindBuffer rewind; //one state pushed every 60hz tick
+    spscQueue commands; //SDL thread -> emulation thread
+    SDL_sem *wake; //posted with every command so a sleeping emulation thread picks it up straight away
+    emuCommand commandItems[COMMAND_QUEUE_SIZE];
+    tripleBuffer frames; //emulation thread -> SDL thread
+    frameSnapshot frameItems[3];
+    atomic_int presenterWaiting; //SDL thread is asleep with nothing to draw, wake it with frameEvent when the display or a control changes
+    Uint32 frameEvent; //SDL user event type, (Uint32)-1 if there wasn't one free and the SDL thread just wakes up every OVERLAY_REFRESH_MS
+    atomic_int running;
+    audioOutput audio; //tone follows the sound timer, set by the emulation thread
+    inputRecorder recorder; //everything that reaches the machine from outside, while recording
+    uint32_t seed; //random number seed after every reset, 0 for the default
+    romDatabase db; //only touched by the emulation thread once it's started
+    int romIndex; //entry in db for the loaded rom, an index since entries move when db grows
+    streamServer *stream; //NULL without --stream, only touched by the emulation thread once it's started
+} emulator;
+
+static void saveRomDatabase(emulator *emu) {
+    if (romdbSave(&emu->db, ROMDB_FILE) != 0) {
+        printf("Failed to save rom database to %s\n", ROMDB_FILE);
+    }
+}
+
+static void useRomDatabase(emulator *emu, const char *name, size_t size) { //call after loading a rom, looks it up or analyses and adds it
+    chip8 *c8 = emu->c8;
+    uint64_t hash = romHash(&c8->mainMemory[CHIP8_ROM_START], size);
+    romEntry *e = romdbFind(&emu->db, hash);
+    if (e == NULL) { //first time, remember it with the settings it's running with now
+        romEntry fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        fresh.hash = hash;
+        const char *base = strrchr(name, '/');
+        snprintf(fresh.name, sizeof(fresh.name), "%s", base ? base + 1 : name);
+        for (char *ch = fresh.name; *ch; ch++) {
+            if (*ch == ' ' || *ch == '\t') *ch = '_'; //names are space separated in the file
+        }
+        fresh.loadStoreRegQuirk = c8->loadStoreRegQuirk;
+        fresh.spriteWrapClipQuirk = c8->spriteWrapClipQuirk;
+        fresh.bitShiftQuirk = c8->bitShiftQuirk;
+        fresh.instructionHz = emu->instructionHz;
+        romAnalyse(c8, &fresh);
+        e = romdbAdd(&emu->db, &fresh);
+        if (e == NULL) {
+            printf("Out of memory for rom database\n");
+            emu->romIndex = -1;
+            return;
+        }
+        printf("New rom %s: %d code ranges, %d idle loops\n", e->name, e->rangeCount, e->idleCount);
+        saveRomDatabase(emu);
+    }
+    emu->romIndex = (int)(e - emu->db.entries);
+    romApply(c8, e);
+    emu->instructionHz = e->instructionHz;
+}
+
+static void updateRomDatabase(emulator *emu) { //settings changed, keep them for next time
+    if (emu->romIndex < 0) return;
+    romEntry *e = &emu->db.entries[emu->romIndex];
+    e->loadStoreRegQuirk = emu->c8->loadStoreRegQuirk;
+    e->spriteWrapClipQuirk = emu->c8->spriteWrapClipQuirk;
+    e->bitShiftQuirk = emu->c8->bitShiftQuirk;
+    e->instructionHz = emu->instructionHz;
+    saveRomDatabase(emu);
+}
+
+int sendCommand(emulator *emu, emuCommand *cmd) { //SDL thread only
+    if (spscPush(&emu->commands, cmd) != 0) {
+        printf("Command queue full, dropped command\n"); //emulation thread is stuck, shouldn't happen
+        return -1;
+    }
+    SDL_SemPost(emu->wake);
+    return 0;
+}
+
+void handleKeyPress(emulator *emu, SDL_Event *event) {
+    if (event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) return;
+    if (event->key.repeat) return; //held keys send repeats, chip8 only cares about up and down
+    int is_pressed = (event->type == SDL_KEYDOWN) ? 1 : 0; 
+    emuCommand cmd = { CMD_KEY, -1, is_pressed };
+    switch(event->key.keysym.sym) {
+        case SDLK_1: cmd.value = 0x1; break;
+        case SDLK_2: cmd.value = 0x2; break;
+        case SDLK_3: cmd.value = 0x3; break;
+        case SDLK_4: cmd.value = 0xC; break;
+        case SDLK_q: cmd.value = 0x4; break;
+        case SDLK_w: cmd.value = 0x5; break;
+        case SDLK_e: cmd.value = 0x6; break;
+        case SDLK_r: cmd.value = 0xD; break;
+        case SDLK_a: cmd.value = 0x7; break;
+        case SDLK_s: cmd.value = 0x8; break;
+        case SDLK_d: cmd.value = 0x9; break;
+        case SDLK_f: cmd.value = 0xE; break;
+        case SDLK_z: cmd.value = 0xA; break;
+        case SDLK_x: cmd.value = 0x0; break;
+        case SDLK_c: cmd.value = 0xB; break;
+        case SDLK_v: cmd.value = 0xF; break;
+        case SDLK_SPACE:
+            if (is_pressed) cmd.type = CMD_PAUSE; //for pausing  
+            break;
+        case SDLK_n:
+            if (is_pressed) cmd.type = CMD_STEP; //only does anything if paused
+            break;
+        case SDLK_TAB:
+            cmd.type = CMD_TURBO; //turbo while held
+            break;
+        case SDLK_BACKSPACE:
+            cmd.type = CMD_REWIND; //rewind while held
+            break;
+        case SDLK_F5:
+            if (is_pressed) cmd.type = CMD_SAVE_STATE;
+            break;
+        case SDLK_F9:
+            if (is_pressed) cmd.type = CMD_LOAD_STATE;
+            break;
+        case SDLK_t:
+            if (is_pressed) cmd.type = CMD_TRACE;
+            break;
+        case SDLK_p:
+            if (is_pressed) cmd.type = CMD_PROFILE;
+            break;
+        case SDLK_F7:
+            if (is_pressed) cmd.type = CMD_RECORD;
+            break;
+    }
+    if (cmd.type == CMD_SAVE_STATE || cmd.type == CMD_LOAD_STATE) {
+        strcpy(cmd.filename, QUICKSAVE_FILE);
+    }
+    if (cmd.type == CMD_TRACE) {
+        strcpy(cmd.filename, TRACE_FILE);
+    }
+    if (cmd.type == CMD_RECORD) {
+        strcpy(cmd.filename, RECORD_FILE);
+    }
+    if (cmd.type != CMD_KEY || cmd.value >= 0) {
+        sendCommand(emu, &cmd);
+    }
+}
+
+enum { PROMPT_NONE, PROMPT_ROM, PROMPT_RATE }; //what the next console line answers, set by the Load ROM and Rate buttons
+
+static int quirkIndex(const char *name) { //control channel names for CMD_TOGGLE_QUIRK values
+    if (strcmp(name, "load") == 0) return 0;
+    if (strcmp(name, "clip") == 0) return 1;
+    if (strcmp(name, "shift") == 0) return 2;
+    return -1;
+}
+
+static void copyPath(char *out, size_t size, const char *text, int skipWord) { //a filename is the rest of the line, spaces and all, trimmed
+    while (isspace((unsigned char)*text)) text++;
+    if (skipWord) {
+        while (*text && !isspace((unsigned char)*text)) text++;
+        while (isspace((unsigned char)*text)) text++;
+    }
+    size_t length = strlen(text);
+    while (length > 0 && isspace((unsigned char)text[length - 1])) length--;
+    snprintf(out, size, "%.*s", (int)length, text);
+}
+
+static int runControlLine(emulator *emu, const char *line, int source, int *prompt) { //SDL thread, one line from the console or socket, returns 1 for quit
+    char word[16], arg[CONTROL_LINE], arg2[16];
+    int n = sscanf(line, "%15s %255s %15s", word, arg, arg2);
+    if (n < 1) return 0; //blank line
+    if (source == CONTROL_CONSOLE && *prompt != PROMPT_NONE) { //answer to a button's question rather than a command
+        if (*prompt == PROMPT_ROM) {
+            emuCommand cmd = { CMD_LOAD_ROM };
+            copyPath(cmd.filename, sizeof(cmd.filename), line, 0);
+            sendCommand(emu, &cmd); //emulation thread resets and loads it
+        } else {
+            int rate = atoi(word);
+            if (rate > 0) {
+                printf("You entered: %d\n", rate);
+                sendCommand(emu, &(emuCommand){ CMD_SET_RATE, rate });
+            } else {
+                printf("Invalid input!\n");
+            }
+        }
+        *prompt = PROMPT_NONE;
+        return 0;
+    }
+
+    emuCommand cmd = { CMD_KEY, -1 };
+    if (strcmp(word, "load") == 0 && n >= 2) {
+        cmd.type = CMD_LOAD_ROM;
+        copyPath(cmd.filename, sizeof(cmd.filename), line, 1);
+    } else if (strcmp(word, "rate") == 0 && n >= 2 && atoi(arg) > 0) {
+        cmd.type = CMD_SET_RATE;
+        cmd.value = atoi(arg);
+    } else if (strcmp(word, "quirk") == 0 && n >= 2 && quirkIndex(arg) >= 0) {
+        cmd.type = n >= 3 ? CMD_SET_QUIRK : CMD_TOGGLE_QUIRK; //quirk clip toggles, quirk clip on/off sets
+        cmd.value = quirkIndex(arg);
+        cmd.pressed = n >= 3 && (strcmp(arg2, "on") == 0 || strcmp(arg2, "1") == 0);
+    } else if (strcmp(word, "pause") == 0 || strcmp(word, "resume") == 0) {
+        cmd.type = CMD_PAUSE;
+        cmd.value = word[0] == 'p';
+    } else if (strcmp(word, "step") == 0) {
+        cmd.type = CMD_STEP;
+    } else if (strcmp(word, "key") == 0 && n >= 3 && strlen(arg) == 1 && strchr("0123456789abcdefABCDEF", arg[0])) {
+        cmd.value = (int)strtol(arg, NULL, 16); //CMD_KEY
+        cmd.pressed = strcmp(arg2, "down") == 0 || strcmp(arg2, "1") == 0;
+    } else if (strcmp(word, "save") == 0 || strcmp(word, "restore") == 0) {
+        cmd.type = word[0] == 's' ? CMD_SAVE_STATE : CMD_LOAD_STATE;
+        copyPath(cmd.filename, sizeof(cmd.filename), n >= 2 ? line : QUICKSAVE_FILE, n >= 2);
+    } else if (strcmp(word, "record") == 0) {
+        cmd.type = CMD_RECORD; //starts or stops, like F7
+        copyPath(cmd.filename, sizeof(cmd.filename), n >= 2 ? line : RECORD_FILE, n >= 2);
+    } else if (strcmp(word, "break") == 0 || strcmp(word, "watch") == 0) {
+        cmd.type = CMD_DEBUG; //checked and answered by the emulation thread, it owns the breakpoints
+        snprintf(cmd.filename, sizeof(cmd.filename), "%s", line);
+    } else if (strcmp(word, "quit") == 0) {
+        return 1;
+    } else if (strcmp(word, "help") == 0) {
+        printf("Commands: load FILE, rate HZ, quirk load|clip|shift [on|off], pause, resume, step, key K down|up, save [FILE], restore [FILE], record [FILE], "
+            "break [ADDR | op CLASS | VX|I ==|!=|<|> VALUE [ADDR] | clear], watch START [END], quit\n");
+        return 0;
+    } else {
+        printf("Unknown command: %s (help lists them)\n", line);
+        return 0;
+    }
+    sendCommand(emu, &cmd);
+    return 0;
+}
+
+static const char *const testNames[] = { "==", "!=", "<", ">" }; //CHIP8_TEST_* order
+
+static int parseHex(const char *text, unsigned *value) { //returns 0 on success, -1 if text isn't a 16 bit hex number
+    char *end;
+    unsigned long n = strtoul(text, &end, 16);
+    if (text[0] == '\0' || *end != '\0' || n > 0xFFFF) return -1;
+    *value = (unsigned)n;
+    return 0;
+}
+
+static int registerIndex(const char *name) { //V0-VF or I, -1 for anything else
+    if ((name[0] == 'V' || name[0] == 'v') && name[1] && !name[2] && strchr("0123456789abcdefABCDEF", name[1])) return (int)strtol(name + 1, NULL, 16);
+    if ((name[0] == 'I' || name[0] == 'i') && !name[1]) return 16;
+    return -1;
+}
+
+static int classIndex(const char *name) { //opcode class from its name, e.g. DXYN, -1 if there isn't one
+    char upper[8];
+    int n = 0;
+    while (name[n] && n < 7) {
+        upper[n] = toupper((unsigned char)name[n]);
+        n++;
+    }
+    upper[n] = '\0';
+    for (int i = 1; i < CHIP8_OPCODE_CLASSES - 1; i++) {
+        if (strcmp(upper, opcodeClassName(i)) == 0) return i;
+    }
+    return -1;
+}
+
+static void listBreakpoints(const chip8 *c8) {
+    const breakpoints *b = &c8->breaks;
+    if (!b->armed) {
+        printf("No breakpoints\n");
+        return;
+    }
+    for (int address = 0; address < CHIP8_MEMORY_SIZE; address++) {
+        if ((b->address[address >> 3] >> (address & 7)) & 1) printf("  break %03X\n", address);
+    }
+    for (int i = 1; i < CHIP8_OPCODE_CLASSES; i++) {
+        if ((b->opcodeClasses >> i) & 1) printf("  break op %s\n", opcodeClassName(i));
+    }
+    for (int i = 0; i < b->registerCount; i++) {
+        const registerBreak *r = &b->registers[i];
+        printf("  break %s%.*X %s %X", r->reg < 16 ? "V" : "I", r->reg < 16, r->reg, testNames[r->test], r->value);
+        if (r->address != CHIP8_ANY_ADDRESS) printf(" %03X", r->address);
+        printf("\n");
+    }
+    for (int i = 0; i < b->watchCount; i++) {
+        printf("  watch %03X %03X\n", b->watches[i].start, b->watches[i].end);
+    }
+}
+
+static void runDebugCommand(chip8 *c8, const char *line) { //emulation thread, break and watch from the control channel
+    char word[16], a[16], b[16], c[16], d[16];
+    int n = sscanf(line, "%15s %15s %15s %15s %15s", word, a, b, c, d);
+    unsigned address, end, value;
+    if (strcmp(word, "watch") == 0) {
+        if (n >= 2 && parseHex(a, &address) == 0 && (n < 3 || parseHex(b, &end) == 0)) {
+            if (n < 3) end = address;
+            if (addWatchpoint(c8, address, end) == 0) {
+                printf("Watching writes to %03X-%03X\n", address < end ? address : end, address < end ? end : address);
+            } else {
+                printf("No watchpoints left, break clear removes them all\n");
+            }
+        } else {
+            printf("Usage: watch START [END], addresses in hex\n");
+        }
+        return;
+    }
+    int reg = n >= 4 ? registerIndex(a) : -1;
+    int test = -1;
+    for (int i = 0; reg >= 0 && i < 4; i++) {
+        if (strcmp(b, testNames[i]) == 0) test = i;
+    }
+    if (n == 1) {
+        listBreakpoints(c8);
+    } else if (strcmp(a, "clear") == 0) {
+        clearBreakpoints(c8);
+        printf("Cleared all breakpoints\n");
+    } else if (strcmp(a, "op") == 0 && n >= 3 && classIndex(b) >= 0) {
+        int opcodeClassBit = (c8->breaks.opcodeClasses >> classIndex(b)) & 1;
+        setOpcodeBreak(c8, classIndex(b), !opcodeClassBit);
+        printf("%s break on %s\n", opcodeClassBit ? "Removed" : "Added", opcodeClassName(classIndex(b)));
+    } else if (test >= 0 && parseHex(c, &value) == 0 && (n < 5 || parseHex(d, &address) == 0)) {
+        if (addRegisterBreak(c8, n >= 5 ? address : CHIP8_ANY_ADDRESS, reg, test, value) == 0) {
+            printf("Added break when %s\n", line + strlen(word) + 1);
+        } else {
+            printf("No register breaks left, break clear removes them all\n");
+        }
+    } else if (n == 2 && parseHex(a, &address) == 0) {
+        address &= 0xFFF;
+        int on = !((c8->breaks.address[address >> 3] >> (address & 7)) & 1);
+        setBreakpoint(c8, address, on);
+        printf("%s breakpoint at %03X\n", on ? "Added" : "Removed", address);
+    } else {
+        printf("Usage: break [ADDR | op CLASS | VX|I ==|!=|<|> VALUE [ADDR] | clear], numbers in hex\n");
+    }
+}
+
+static void breakStopped(emulator *emu) { //emulation thread, stepInstructions stopped on a breakpoint, pause there until resumed
+    chip8 *c8 = emu->c8;
+    const breakpoints *b = &c8->breaks;
+    uint16_t opcode = (c8->mainMemory[b->stopPC & 0xFFF] << 8) | c8->mainMemory[(b->stopPC + 1) & 0xFFF];
+    emu->paused = 1;
+    if (b->stopReason == CHIP8_STOP_PC) {
+        printf("Breakpoint at %03X (%04X)\n", b->stopPC, opcode);
+    } else if (b->stopReason == CHIP8_STOP_OPCODE) {
+        printf("%s at %03X (%04X)\n", opcodeClassName(b->stopIndex), b->stopPC, opcode);
+    } else if (b->stopReason == CHIP8_STOP_REGISTER) {
+        const registerBreak *r = &b->registers[b->stopIndex];
+        if (b->stoppedBefore) {
+            printf("%s%.*X %s %X at %03X (%04X)\n", r->reg < 16 ? "V" : "I", r->reg < 16, r->reg, testNames[r->test], r->value, b->stopPC, opcode);
+        } else {
+            printf("%s%.*X %s %X after %03X, stopped at %03X\n", r->reg < 16 ? "V" : "I", r->reg < 16, r->reg, testNames[r->test], r->value, b->stopAddress, b->stopPC);
+        }
+    } else {
+        const watchpoint *w = &b->watches[b->stopIndex];
+        printf("%04X at %03X is about to write %03X (watch %03X-%03X)\n", opcode, b->stopPC, b->stopAddress, w->start, w->end);
+    }
+}
+
+static void runCommand(emulator *emu, emuCommand *cmd) { //emulation thread
+    chip8 *c8 = emu->c8;
+    switch (cmd->type) {
+        case CMD_KEY:
+            setKey(c8, cmd->value, cmd->pressed);
+            recordKey(&emu->recorder, cmd->value, cmd->pressed);
+            break;
+        case CMD_PAUSE: emu->paused = cmd->value < 0 ? !emu->paused : cmd->value; break;
+        case CMD_STEP:
+            if (emu->paused) {
+                fetchDecodeExecute(c8);
+                recordRan(&emu->recorder, 1);
+            }
+            break;
+        case CMD_TOGGLE_QUIRK:
+        case CMD_SET_QUIRK:
+            if (cmd->value == 0) c8->loadStoreRegQuirk = cmd->type == CMD_SET_QUIRK ? cmd->pressed : !c8->loadStoreRegQuirk;
+            if (cmd->value == 1) c8->spriteWrapClipQuirk = cmd->type == CMD_SET_QUIRK ? cmd->pressed : !c8->spriteWrapClipQuirk;
+            if (cmd->value == 2) c8->bitShiftQuirk = cmd->type == CMD_SET_QUIRK ? cmd->pressed : !c8->bitShiftQuirk;
+            selectInterpreter(c8);
+            recordQuirks(&emu->recorder, c8);
+            updateRomDatabase(emu);
+            break;
+        case CMD_LOAD_ROM: {
+            uint8_t buffer[CHIP8_MAX_ROM_SIZE + 1];
+            size_t size;
+            if (readROM(cmd->filename, buffer, &size) != 0) {
+                break; //readROM said why, the current rom carries on
+            }
+            initialiseSystem(c8);
+            seedRandom(c8, emu->seed);
+            loadROMBuffer(c8, buffer, size);
+            useRomDatabase(emu, cmd->filename, size);
+            rewindClear(&emu->rewind); //history is for the old rom
+            recordState(&emu->recorder, c8);
+            break;
+        }
+        case CMD_SET_RATE:
+            if (cmd->value > 0) {
+                emu->instructionHz = cmd->value;
+                updateRomDatabase(emu);
+            }
+            break;
+        case CMD_TURBO: emu->turboHeld = cmd->pressed; break;
+        case CMD_REWIND:
+            if (emu->rewinding && !cmd->pressed) recordState(&emu->recorder, c8); //machine went back in time, carry on from where it ended up
+            emu->rewinding = cmd->pressed;
+            break;
+        case CMD_SAVE_STATE:
+            if (saveSnapshotFile(c8, cmd->filename) == 0) {
+                printf("Saved state to %s\n", cmd->filename);
+            } else {
+                printf("Failed to save state to %s\n", cmd->filename);
+            }
+            break;
+        case CMD_LOAD_STATE:
+            if (loadSnapshotFile(c8, cmd->filename) == 0) {
+                rewindClear(&emu->rewind);
+                recordState(&emu->recorder, c8);
+                printf("Loaded state from %s\n", cmd->filename);
+            } else {
+                printf("Failed to load state from %s\n", cmd->filename);
+            }
+            break;
+        case CMD_TRACE:
+#ifdef CHIP8_TRACE
+            if (c8->trace) {
+                traceStop(c8);
+                printf("Stopped trace\n");
+            } else if (traceStart(c8, cmd->filename) == 0) {
+                printf("Tracing to %s\n", cmd->filename);
+            } else {
+                printf("Failed to start trace to %s\n", cmd->filename);
+            }
+#else
+            printf("Built without CHIP8_TRACE, no tracing\n");
+#endif
+            break;
+        case CMD_RECORD:
+            if (emu->recorder.file) {
+                printf("Stopped recording, %llu events\n", (unsigned long long)emu->recorder.events);
+                recordStop(&emu->recorder);
+            } else if (recordStart(&emu->recorder, c8, cmd->filename) == 0) {
+                printf("Recording to %s\n", cmd->filename);
+            } else {
+                printf("Failed to start recording to %s\n", cmd->filename);
+            }
+            break;
+        case CMD_PROFILE:
+#ifdef CHIP8_PROFILE
+            if (c8->profile) {
+                profileStop(c8, PROFILE_REPORT_FILE, PROFILE_FOLDED_FILE);
+                printf("Wrote %s and %s\n", PROFILE_REPORT_FILE, PROFILE_FOLDED_FILE);
+            } else if (profileStart(c8) == 0) {
+                printf("Profiling\n");
+            }
+#else
+            printf("Built without CHIP8_PROFILE, no profiling\n");
+#endif
+            break;
+        case CMD_DEBUG: runDebugCommand(c8, cmd->filename); break;
+    }
+}
+
+static void publishFrame(emulator *emu) { //emulation thread, copy out what the overlay needs
+    chip8 *c8 = emu->c8;
+    frameSnapshot *frame = tripleWriteBuffer(&emu->frames);
+    if (frame->displayGeneration != c8->displayGeneration) { //this buffer's copy is out of date, most publishes nothing was drawn
+        memcpy(frame->display, c8->display, sizeof(frame->display));
+        frame->displayGeneration = c8->displayGeneration;
+    }
+    frame->hires = c8->hires;
+    frame->regs = c8->regs;
+    memcpy(frame->stack, c8->stack, sizeof(frame->stack));
+    memcpy(frame->keys, c8->keys, sizeof(frame->keys));
+    frame->lastInstruction = c8->lastInstruction;
+    frame->loadStoreRegQuirk = c8->loadStoreRegQuirk;
+    frame->spriteWrapClipQuirk = c8->spriteWrapClipQuirk;
+    frame->bitShiftQuirk = c8->bitShiftQuirk;
+    frame->instructionHz = emu->instructionHz;
+    frame->turboActive = emu->turboHeld;
+    frame->rewinding = emu->rewinding;
+    frame->rewindFrames = emu->rewind.count;
+    frame->rewindBytes = emu->rewind.bytesUsed;
+    frame->paused = emu->paused;
+    frame->waitingForKey = c8->keyWait != 0;
+    frame->recording = emu->recorder.file != NULL;
+    frame->tickLateness = emu->sched.tickLateness;
+    triplePublish(&emu->frames);
+}
+
+static int controlsChanged(const frameSnapshot *a, const frameSnapshot *b) { //SDL thread, status text and checkboxes, redrawn as soon as they change
+    return a->loadStoreRegQuirk != b->loadStoreRegQuirk || a->spriteWrapClipQuirk != b->spriteWrapClipQuirk || a->bitShiftQuirk != b->bitShiftQuirk
+        || a->instructionHz != b->instructionHz || a->turboActive != b->turboActive || a->rewinding != b->rewinding
+        || a->paused != b->paused || a->waitingForKey != b->waitingForKey || a->recording != b->recording;
+}
+
+static int readoutsChanged(const frameSnapshot *a, const frameSnapshot *b) { //SDL thread, register panel and rewind figures, only compared as precisely as they're shown
+    return memcmp(a->regs.V, b->regs.V, sizeof(a->regs.V)) != 0 || a->regs.I != b->regs.I || a->regs.DT != b->regs.DT || a->regs.ST != b->regs.ST
+        || a->regs.PC != b->regs.PC || a->regs.SP != b->regs.SP || memcmp(a->stack, b->stack, sizeof(a->stack)) != 0
+        || memcmp(a->keys, b->keys, sizeof(a->keys)) != 0 || a->lastInstruction != b->lastInstruction
+        || a->rewindFrames / 6 != b->rewindFrames / 6 || (a->rewindBytes + 1023) / 1024 != (b->rewindBytes + 1023) / 1024; //tenths of a second and KB
+}
+
+static int runScheduled(emulator *emu) { //emulation thread, catch up on instructions and timer ticks owed since last time, returns 1 if anything ran
+    chip8 *c8 = emu->c8;
+    scheduler *s = &emu->sched;
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t elapsed = now - s->last;
+    s->last = now;
+    if (emu->paused) return 0; //remainders are kept so sub frame timing survives pausing
+    if (elapsed > s->frequency / 4) elapsed = s->frequency / 4; //thread wasn't scheduled for a while, don't try to catch up more than a quarter second
+
+    int uncapped = emu->turboHeld && emu->turbo == 0 && !emu->rewinding;
+    uint64_t rate = (uint64_t)emu->instructionHz * (emu->turboHeld && emu->turbo > 0 ? emu->turbo : 1); //turbo only speeds up instructions, timers stay on the wall clock
+    int ran = 0;
+    while (elapsed > 0) {
+        uint64_t untilTick = (s->frequency - s->timerRemainder + 59) / 60; //counter ticks until the next timer tick, rounded up
+        uint64_t slice = elapsed < untilTick ? elapsed : untilTick;
+        if (!uncapped && !emu->rewinding) {
+            s->instructionRemainder += slice * rate;
+            uint64_t count = s->instructionRemainder / s->frequency;
+            s->instructionRemainder -= count * s->frequency;
+            if (count > 0) {
+                stepInstructions(c8, (int)count);
+                recordRan(&emu->recorder, (int)count - c8->breaks.unrun); //what a breakpoint stopped short of never ran
+                ran = 1;
+                if (c8->breaks.stopReason) {
+                    breakStopped(emu);
+                    return ran;
+                }
+            }
+        }
+        s->timerRemainder += slice * 60;
+        elapsed -= slice;
+        if (s->timerRemainder >= s->frequency) {
+            s->timerRemainder -= s->frequency;
+            addTiming(&s->tickLateness, (elapsed + s->timerRemainder / 60) * 1000.0 / s->frequency); //time between when the tick was due and now
+            if (emu->rewinding) {
+                rewindStep(&emu->rewind, c8); //back one frame, stays on the oldest once it runs out
+            } else {
+                tickTimers(c8); //decrement delay and sound timer by 1
+                recordTick(&emu->recorder, c8);
+                rewindPush(&emu->rewind, c8);
+            }
+            if (emu->stream) streamFrame(emu->stream, c8); //viewers get at most one frame a tick, whatever rate the machine runs at
+            ran = 1;
+        }
+    }
+
+    if (uncapped) { //as many instructions as fit in the next millisecond, timer ticks are still caught up above
+        uint64_t deadline = now + s->frequency / 1000;
+        do {
+            stepInstructions(c8, 1000);
+            recordRan(&emu->recorder, 1000 - c8->breaks.unrun);
+        } while (!c8->idle && !c8->breaks.stopReason && SDL_GetPerformanceCounter() < deadline); //waiting on a tick or key, nothing to do until then
+        if (c8->breaks.stopReason) breakStopped(emu);
+        ran = 1;
+    }
+    return ran;
+}
+
+static Uint32 sleepTime(emulator *emu) { //ms the emulation thread can sleep before there's something to do, a command wakes it sooner
+    if (emu->c8->keyWait && !emu->rewinding) { //stopped on FX0A, only the timers need the thread until a key comes in
+        scheduler *s = &emu->sched;
+        uint64_t untilTick = (s->frequency - s->timerRemainder + 59) / 60;
+        return (Uint32)(untilTick * 1000 / s->frequency) + 1;
+    }
+    return 1; //whatever time actually passed is caught up next loop
+}
+
+int emulationThread(void *data) {
+    emulator *emu = data;
+    emu->sched.frequency = SDL_GetPerformanceFrequency();
+    emu->sched.last = SDL_GetPerformanceCounter();
+
+    while (atomic_load(&emu->running)) {
+        emuCommand cmd;
+        int changed = 0;
+        int commanded = 0;
+        uint32_t generation = emu->c8->displayGeneration;
+        while (spscPop(&emu->commands, &cmd) == 0) { //everything the SDL thread sent since last time
+            runCommand(emu, &cmd);
+            changed = 1;
+            commanded = 1;
+        }
+        if (emu->stream) {
+            uint8_t keys[STREAM_MAX_KEYS];
+            int count = streamPoll(emu->stream, emu->c8, keys, STREAM_MAX_KEYS); //never blocks, viewers that can't keep up just miss frames
+            for (int i = 0; i < count; i++) {
+                int key = keys[i] & 0xF, pressed = keys[i] >= STREAM_KEY_DOWN;
+                setKey(emu->c8, key, pressed);
+                recordKey(&emu->recorder, key, pressed);
+                changed = 1;
+            }
+            if (commanded) streamFrame(emu->stream, emu->c8); //a load, step or restore while paused shows up without waiting for a tick
+        }
+
+        if (runScheduled(emu)) {
+            changed = 1;
+        }
+        setSound(&emu->audio, emu->c8->regs.ST > 0 && !emu->paused && !emu->rewinding); //FX18 or a tick may have changed it, the callback picks it up next buffer
+
+        if (changed) {
+            publishFrame(emu);
+            int visible = commanded || emu->c8->displayGeneration != generation; //something the SDL thread should draw now rather than at its next overlay refresh
+            if (visible && emu->frameEvent != (Uint32)-1 && atomic_exchange(&emu->presenterWaiting, 0)) {
+                SDL_Event wake = { .type = emu->frameEvent };
+                SDL_PushEvent(&wake); //thread safe, at most one each time the SDL thread goes to sleep
+            }
+        }
+        if (!(emu->turboHeld && emu->turbo == 0) || emu->c8->idle) {
+            SDL_SemWaitTimeout(emu->wake, sleepTime(emu));
+        }
+    }
+    return 0;
+}
+
+int drawCheckbox(SDL_Renderer *renderer, int x, int y, int checked, int mouseX, int mouseY, int mouseDown) {
+    SDL_Rect box = {x, y, 16, 16};
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawRect(renderer, &box);
+    if (checked) {
+        SDL_SetRenderDrawColor(renderer, 0, 200, 0, 255);
+        SDL_Rect fill = {x+3, y+3, 10, 10};
+        SDL_RenderFillRect(renderer, &fill);
+    }
+    // If mouse is down and inside box, return 1
+    if (mouseDown && mouseX >= x && mouseX <= x+16 && mouseY >= y && mouseY <= y+16)
+        return 1;
+    return 0;
+}
+
+int drawButton(SDL_Renderer *renderer, int x, int y, int w, int h, const char *label, int mouseX, int mouseY, int mouseDown, textRenderer *glyphs) {
+    SDL_SetRenderDrawColor(renderer, 70, 70, 200, 255);
+    SDL_Rect rect = {x, y, w, h};
+    SDL_RenderFillRect(renderer, &rect);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawRect(renderer, &rect);
+    drawText(glyphs, x + 10, y + 5, label, (SDL_Color){255,255,255,255});
+    if (mouseDown && mouseX >= x && mouseX <= x+w && mouseY >= y && mouseY <= y+h)
+        return 1;
+    return 0;
+}
+
+void drawMemoryHex(chip8 *c8, textRenderer *glyphs) {
+    SDL_Color gray = {180, 180, 180, 255};
+    char line[64];
+    int lines = 32; // mumber of lines to show 
+    int bytesPerLine = 8; // how many bytes shown on every line
+
+    for (int i = 0; i < lines; i++) {
+        int addr = 0x200 + i * bytesPerLine;
+        if (addr >= 4096) break;
+        int len = snprintf(line, sizeof(line), "%03X: ", addr);
+        for (int j = 0; j < bytesPerLine && (addr + j) < 4096; j++) {
+            len += snprintf(line + len, sizeof(line) - len, "%02X ", c8->mainMemory[addr + j]);
+        }
+        drawText(glyphs, 10, 10 + i * 18, line, gray);
+    }
+}
+
+int main(int argc, char *argv[]){ //for SDL
+    static chip8 machine; //static so the 4k+ of machine state isn't on the stack
+    chip8 *c8 = &machine;
+    displayRenderer dr = { NULL, 10, 0xFFFFFFFF, 0xFF000000, 0xFFAAAAAA, 0xFF555555 }; //10x10 window pixels per chip8 pixel, white on black, greys for the XO-CHIP second plane
+    int instructionHz = 600; //10 instructions per 60hz frame
+    int turbo = 8;
+    int volume = 25; //percent
+    int frameSkip = 0; //refreshes to leave between presents of a changing display
+    uint32_t seed = 0; //default seed
+    const char *recordPath = NULL;
+    const char *controlPath = NULL;
+    const char *streamAddress = NULL;
+    for (int i = 1; i < argc; i++) { //--scale N, --fg RRGGBB, --bg RRGGBB, --fg2 RRGGBB, --fg3 RRGGBB, --hz N, --turbo N, --volume N, --seed N, --record file, --frameskip N, --control socket, --stream port|socket
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            dr.scale = atoi(argv[++i]);
+            if (dr.scale < 1) dr.scale = 1;
+        } else if (strcmp(argv[i], "--fg") == 0 && i + 1 < argc) {
+            dr.onColour = 0xFF000000 | (uint32_t)strtoul(argv[++i], NULL, 16);
+        } else if (strcmp(argv[i], "--bg") == 0 && i + 1 < argc) {
+            dr.offColour = 0xFF000000 | (uint32_t)strtoul(argv[++i], NULL, 16);
+        } else if (strcmp(argv[i], "--fg2") == 0 && i + 1 < argc) {
+            dr.plane2Colour = 0xFF000000 | (uint32_t)strtoul(argv[++i], NULL, 16);
+        } else if (strcmp(argv[i], "--fg3") == 0 && i + 1 < argc) {
+            dr.bothColour = 0xFF000000 | (uint32_t)strtoul(argv[++i], NULL, 16);
+        } else if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            instructionHz = atoi(argv[++i]);
+            if (instructionHz < 1) instructionHz = 1;
+        } else if (strcmp(argv[i], "--turbo") == 0 && i + 1 < argc) {
+            turbo = atoi(argv[++i]); //0 is uncapped
+            if (turbo < 0) turbo = 0;
+        } else if (strcmp(argv[i], "--volume") == 0 && i + 1 < argc) {
+            volume = atoi(argv[++i]); //0 to 100, 0 is silent
+            if (volume < 0) volume = 0;
+            if (volume > 100) volume = 100;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i]; //record from the start, F7 stops it
+        } else if (strcmp(argv[i], "--frameskip") == 0 && i + 1 < argc) {
+            frameSkip = atoi(argv[++i]); //0 presents every change
+            if (frameSkip < 0) frameSkip = 0;
+        } else if (strcmp(argv[i], "--control") == 0 && i + 1 < argc) {
+            controlPath = argv[++i]; //UNIX domain socket to take commands on as well as the console
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            streamAddress = argv[++i]; //port or UNIX domain socket to stream the display on
+        }
+    }
+    int panelX = CHIP8_DISPLAY_WIDTH * dr.scale + 10; //registers etc go to the right of the display
+    if (panelX < 650) panelX = 650;
+    int bottomY = CHIP8_DISPLAY_HEIGHT * dr.scale + 90; //buttons go below the display
+    if (bottomY < 520) bottomY = 520;
+    dumpBinaryToText("Play.ch8", "Play_dump.txt"); //view game binary
+    initialiseSystem(c8); //initalise memory/registers etc
+    seedRandom(c8, seed);
+    size_t romSize = loadROM(c8, "Play.ch8"); //loads rom Play.ch8 into memory
+
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO); //for SDL TTF errors
+    if (TTF_Init() == -1) {
+    printf("TTF_Init: %s\n", TTF_GetError());
+    exit(1);
+    }
+    TTF_Font *font = TTF_OpenFont("arial.ttf", 16); //need arial.ttf in same folder
+    if (!font) {
+        printf("Failed to load font: %s\n", TTF_GetError());
+        exit(1);
+    }
+    SDL_Window *window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, panelX + 250, bottomY + 40, 0); //900x560 at the default scale, display 640x320
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC); //default driver gpu accelerated if possible, present waits for vsync
+    if (createDisplayRenderer(&dr, renderer) != 0) {
+        exit(1);
+    }
+    static textRenderer textCache; //static, vertex buffers are too big for the stack
+    textRenderer *glyphs = &textCache;
+    if (createTextRenderer(glyphs, renderer, font) != 0) {
+        exit(1);
+    }
+    TTF_CloseFont(font); //everything needed is in the atlas now
+
+    static emulator emu; //static, holds three frame snapshots and the command queue
+    emu.c8 = c8;
+    emu.instructionHz = instructionHz;
+    emu.turbo = turbo;
+    emu.paused = 0;
+    romdbLoad(&emu.db, ROMDB_FILE); //fine if it's not there yet, it's made when the first rom is added
+    useRomDatabase(&emu, "Play.ch8", romSize); //quirks and rate for Play.ch8, before the emulation thread starts
+    emu.seed = seed;
+    if (recordPath) {
+        if (recordStart(&emu.recorder, c8, recordPath) == 0) {
+            printf("Recording to %s\n", recordPath);
+        } else {
+            printf("Failed to start recording to %s\n", recordPath);
+        }
+    }
+    spscInit(&emu.commands, emu.commandItems, COMMAND_QUEUE_SIZE, sizeof(emuCommand));
+    emu.wake = SDL_CreateSemaphore(0);
+    if (!emu.wake) {
+        printf("Failed to create semaphore: %s\n", SDL_GetError());
+        exit(1);
+    }
+    tripleInit(&emu.frames, emu.frameItems, sizeof(frameSnapshot));
+    if (rewindInit(&emu.rewind, REWIND_ARENA_SIZE) != 0) {
+        printf("Failed to allocate rewind buffer\n");
+        exit(1);
+    }
+    atomic_init(&emu.running, 1);
+    atomic_init(&emu.presenterWaiting, 0);
+    Uint32 userEvents = SDL_RegisterEvents(2); //(Uint32)-1 if none are left, the SDL thread then only wakes on its own timeout
+    emu.frameEvent = userEvents;
+    Uint32 controlEvent = userEvents == (Uint32)-1 ? userEvents : userEvents + 1;
+    static controlChannel control; //static, holds both line queues
+    controlStart(&control, controlPath, controlEvent); //console always, carries on without the socket if it can't be made
+    int prompt = PROMPT_NONE;
+    openAudio(&emu.audio, volume / 100.0f); //carries on without sound if there's no device
+    static streamServer stream; //static, a send queue and display copy per client
+    if (streamAddress && streamOpen(&stream, streamAddress) == 0) {
+        emu.stream = &stream;
+        printf("Streaming the display on %s\n", streamAddress);
+    }
+    publishFrame(&emu); //something to draw before the first frame runs
+    SDL_Thread *emuThread = SDL_CreateThread(emulationThread, "chip8", &emu);
+    if (!emuThread) {
+        printf("Failed to create emulation thread: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    SDL_Event event; //stores input/quit events
+    timingStats frameTimes = {0};
+    uint64_t lastPresent = 0;
+    static frameSnapshot shown; //what's on screen, static since it holds a whole display
+    Uint32 lastDraw = 0; //SDL_GetTicks of the last present
+    int input = 1; //an event came in since the last present (keys, mouse, window uncovered), draw whatever is newest, 1 for the first frame
+    int open = 1;
+    // The window is only drawn and presented when something visible changed: the display (its generation moved), a control or
+    // status line, any input, or the register panel once OVERLAY_REFRESH_MS has passed. Otherwise the thread sleeps in
+    // SDL_WaitEventTimeout and the emulation thread sends frameEvent when a new display or a command's result is published,
+    // so a still screen costs a wakeup every OVERLAY_REFRESH_MS instead of a full redraw every vsync.
+    while (open) {
+        atomic_store(&emu.presenterWaiting, 1); //before reading the frame so nothing published after it is missed
+        while (SDL_PollEvent(&event)) { //Check if user quit or not
+            if (event.type == SDL_QUIT) open = 0; //SDL_QUIT is close window button
+            if (event.type != emu.frameEvent && event.type != controlEvent) input = 1;
+            handleKeyPress(&emu, &event); // send key presses to the emulation thread
+        }
+        char line[CONTROL_LINE];
+        int source;
+        while ((source = controlPoll(&control, line)) != 0) { //commands typed or sent to the socket, their effect comes back in a frame
+            if (runControlLine(&emu, line, source, &prompt)) open = 0;
+        }
+
+        frameSnapshot *frame = tripleReadBuffer(&emu.frames, NULL); //newest frame the emulation thread finished, stays ours until the next read
+        Uint32 sinceDraw = SDL_GetTicks() - lastDraw;
+        Uint32 wait = 0; //ms until there's something to draw
+        if (input || controlsChanged(frame, &shown)) {
+            wait = 0;
+        } else if (frame->displayGeneration != shown.displayGeneration || frame->hires != shown.hires) {
+            Uint32 gap = frameSkip * 1000 / 60; //--frameskip holds a changing display back for that many refreshes after a present
+            wait = sinceDraw < gap ? gap - sinceDraw : 0;
+            atomic_store(&emu.presenterWaiting, 0); //already know, more draws don't need to wake us before the gap is up
+        } else if (readoutsChanged(frame, &shown)) {
+            wait = sinceDraw < OVERLAY_REFRESH_MS ? OVERLAY_REFRESH_MS - sinceDraw : 0;
+        } else {
+            wait = OVERLAY_REFRESH_MS; //nothing changed, look at the register panel again in a bit
+        }
+        if (wait > 0) {
+            lastPresent = 0; //the gap isn't a slow present
+            if (SDL_WaitEventTimeout(&event, wait)) {
+                if (event.type == SDL_QUIT) open = 0;
+                if (event.type != emu.frameEvent && event.type != controlEvent) input = 1;
+                handleKeyPress(&emu, &event);
+            }
+            continue;
+        }
+        atomic_store(&emu.presenterWaiting, 0); //drawing anyway
+        input = 0;
+
+        uint64_t frameStart = SDL_GetPerformanceCounter();
+        if (lastPresent != 0) {
+            addTiming(&frameTimes, (frameStart - lastPresent) * 1000.0 / SDL_GetPerformanceFrequency()); //time between presents, should be the refresh rate
+        }
+        lastPresent = frameStart;
+
+        // 4. Render display
+        drawDisplay(frame->display, frame->hires, renderer, &dr);
+        // drawMemoryHex(c8, glyphs); //Showing ROM instructions in hex (disabled for now, too long)
+
+        SDL_Color white = {255,255,255,255};
+
+        drawText(glyphs, 300, bottomY, "Pause: spc Step: n", white);
+        if (frame->paused) { //show paused if paused
+            drawText(glyphs, 570, bottomY, "PAUSED", white);
+}
+        if (frame->waitingForKey) {
+            drawText(glyphs, 300, bottomY + 20, "Waiting for key", white);
+        }
+        if (frame->recording) {
+            drawText(glyphs, 10, bottomY - 20, "Recording (F7 stops)", white);
+        }
+        if (frame->rewinding) {
+            drawText(glyphs, 570, bottomY + 20, "REWIND", white);
+        } else if (frame->turboActive) {
+            drawText(glyphs, 570, bottomY + 20, emu.turbo ? "TURBO" : "UNCAPPED", white);
+        }
+        char buf[128];
+
+        // Registers
+        for (int i = 0; i < 16; i++) {
+            sprintf(buf, "V%X: %02X", i, frame->regs.V[i]); //put register values into buf char array and then put on screen using drawText
+            drawText(glyphs, panelX, 10 + i * 20, buf, white);
+        }
+        sprintf(buf, "I: %04X", frame->regs.I); drawText(glyphs, panelX, 340, buf, white);
+        sprintf(buf, "PC: %04X", frame->regs.PC); drawText(glyphs, panelX, 360, buf, white);
+        sprintf(buf, "SP: %02X", frame->regs.SP); drawText(glyphs, panelX, 380, buf, white);
+        sprintf(buf, "DT: %02X", frame->regs.DT); drawText(glyphs, panelX, 400, buf, white);
+        sprintf(buf, "ST: %02X", frame->regs.ST); drawText(glyphs, panelX, 420, buf, white);
+
+        //Last Instruction
+        sprintf(buf, "Instr: %04X", frame->lastInstruction); 
+        drawText(glyphs, panelX, 440, buf, white);
+
+        //Instruction rate
+        sprintf(buf, "Rate: %d Hz", frame->instructionHz); 
+        drawText(glyphs, 500, bottomY - 80, buf, white);
+
+        //Timing jitter, how late timer ticks ran and how even the presents are
+        sprintf(buf, "Tick late: %.2fms sd %.2f max %.2f", frame->tickLateness.mean, timingStdDev(&frame->tickLateness), frame->tickLateness.max);
+        drawText(glyphs, 10, bottomY - 80, buf, white);
+        sprintf(buf, "Frame: %.2fms sd %.2f max %.2f", frameTimes.mean, timingStdDev(&frameTimes), frameTimes.max);
+        drawText(glyphs, 10, bottomY - 60, buf, white);
+        sprintf(buf, "Rewind: %.1fs %zuKB", frame->rewindFrames / 60.0, (frame->rewindBytes + 1023) / 1024);
+        drawText(glyphs, 10, bottomY - 40, buf, white);
+
+        // Stack
+        for (int i = 0; i < 16; i++) {
+            sprintf(buf, "S%X: %04X", i, frame->stack[i]);
+            drawText(glyphs, panelX + 100, 10 + i * 20, buf, white);
+        }
+
+        // Keys
+        for (int i = 0; i < 16; i++) {
+            sprintf(buf, "K%X: %d", i, frame->keys[i]);
+            drawText(glyphs, panelX + 200, 10 + i * 20, buf, white);
+        }
+
+        // Quirk flags
+        sprintf(buf, "loadStoreRegQuirk: %d", frame->loadStoreRegQuirk);
+        drawText(glyphs, panelX, 460, buf, white);
+        sprintf(buf, "spriteWrapClipQuirk: %d", frame->spriteWrapClipQuirk);
+        drawText(glyphs, panelX, 480, buf, white);
+        sprintf(buf, "bitShiftQuirk: %d", frame->bitShiftQuirk);
+        drawText(glyphs, panelX, 500, buf, white);
+
+        // Get mouse state
+        int mouseX, mouseY;
+        Uint32 mouseState = SDL_GetMouseState(&mouseX, &mouseY);
+        int mouseDown = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
+
+        // Draw checkboxes and toggle quirks if clicked
+        if (drawCheckbox(renderer, panelX + 170, 460, frame->loadStoreRegQuirk, mouseX, mouseY, mouseDown)) {
+            sendCommand(&emu, &(emuCommand){ CMD_TOGGLE_QUIRK, 0 });
+        }
+        if (drawCheckbox(renderer, panelX + 170, 480, frame->spriteWrapClipQuirk, mouseX, mouseY, mouseDown)) {
+            sendCommand(&emu, &(emuCommand){ CMD_TOGGLE_QUIRK, 1 });
+        }
+        if (drawCheckbox(renderer, panelX + 170, 500, frame->bitShiftQuirk, mouseX, mouseY, mouseDown)) {
+            sendCommand(&emu, &(emuCommand){ CMD_TOGGLE_QUIRK, 2 });
+        }
+
+        // Draw "Load ROM" button
+        if (drawButton(renderer, panelX, bottomY, 120, 30, "Load ROM", mouseX, mouseY, mouseDown, glyphs)) {
+            printf("Enter ROM filename: ");
+            fflush(stdout);
+            prompt = PROMPT_ROM; //the next console line is the answer, nothing waits for it
+        }
+
+        // Draw "Rate" button
+        if (drawButton(renderer, 450, bottomY, 120, 30, "Rate", mouseX, mouseY, mouseDown, glyphs)) {
+            printf("Enter instructions per second (default 600, 10 per frame at 60fps): ");
+            fflush(stdout); // Ensure prompt is shown before input
+            prompt = PROMPT_RATE;
+        }
+
+        flushText(glyphs, renderer); //all the text in one draw, on top of buttons
+
+        SDL_RenderPresent(renderer); //update window with everything drawn since renderclear, waits for vsync so this is what paces the SDL thread while the display is changing
+        shown = *frame;
+        lastDraw = SDL_GetTicks();
+    }
+
+    controlStop(&control);
+    atomic_store(&emu.running, 0);
+    SDL_WaitThread(emuThread, NULL);
+    if (emu.stream) streamClose(emu.stream);
+    SDL_DestroySemaphore(emu.wake);
+    closeAudio(&emu.audio);
+    recordStop(&emu.recorder); //end event so the replay knows it's complete
+#ifdef CHIP8_TRACE
+    traceStop(c8); //flush anything still in the ring
+#endif
+#ifdef CHIP8_PROFILE
+    profileStop(c8, PROFILE_REPORT_FILE, PROFILE_FOLDED_FILE); //nothing if not profiling
+#endif
+    rewindFree(&emu.rewind);
+    romdbFree(&emu.db);
+
+    SDL_DestroyTexture(dr.texture);
+    SDL_DestroyTexture(glyphs->atlas);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <string.h>
+#include "audio.h"
+
+static float polyBlep(float t, float dt) { //correction for the step at t = 0, smooths it over one sample each side
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0f;
+    }
+    if (t > 1.0f - dt) {
+        t = (t - 1.0f) / dt;
+        return t * t + t + t + 1.0f;
+    }
+    return 0.0f;
+}
+
+static void audioCallback(void *data, Uint8 *stream, int len) { //SDL audio thread
+    audioOutput *a = data;
+    float *out = (float *)stream;
+    int samples = len / (int)sizeof(float);
+    int gate = atomic_load_explicit(&a->gate, memory_order_relaxed);
+    float dt = (float)atomic_load_explicit(&a->toneHz, memory_order_relaxed) / AUDIO_SAMPLE_RATE; //phase step per sample
+    float target = gate ? a->volume : 0.0f;
+    float ramp = a->volume / (AUDIO_SAMPLE_RATE * AUDIO_RAMP_MS / 1000); //gain change per sample
+    if (!gate && a->gain == 0.0f) { //quiet, nothing to make
+        memset(stream, 0, len);
+        return;
+    }
+    for (int i = 0; i < samples; i++) {
+        if (a->gain < target) {
+            a->gain = a->gain + ramp > target ? target : a->gain + ramp;
+        } else if (a->gain > target) {
+            a->gain = a->gain - ramp < target ? target : a->gain - ramp;
+        }
+        float falling = a->phase + 0.5f; //second edge of the cycle
+        if (falling >= 1.0f) falling -= 1.0f;
+        float square = (a->phase < 0.5f ? 1.0f : -1.0f) + polyBlep(a->phase, dt) - polyBlep(falling, dt);
+        out[i] = square * a->gain;
+        a->phase += dt;
+        if (a->phase >= 1.0f) a->phase -= 1.0f;
+    }
+}
+
+int openAudio(audioOutput *a, float volume) {
+    atomic_init(&a->gate, 0);
+    atomic_init(&a->toneHz, AUDIO_TONE_HZ);
+    a->volume = volume;
+    a->phase = 0.0f;
+    a->gain = 0.0f;
+    SDL_AudioSpec want, have;
+    memset(&want, 0, sizeof(want));
+    want.freq = AUDIO_SAMPLE_RATE;
+    want.format = AUDIO_F32SYS;
+    want.channels = 1;
+    want.samples = AUDIO_BUFFER_SAMPLES;
+    want.callback = audioCallback;
+    want.userdata = a;
+    a->device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0); //no changes allowed, SDL converts if the device wants something else
+    if (a->device == 0) {
+        printf("Failed to open audio: %s\n", SDL_GetError());
+        return -1;
+    }
+    SDL_PauseAudioDevice(a->device, 0); //start the callback, it makes silence until the gate opens
+    return 0;
+}
+
+void closeAudio(audioOutput *a) {
+    if (a->device) {
+        SDL_CloseAudioDevice(a->device);
+        a->device = 0;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef CHIP8_AUDIO_H
+#define CHIP8_AUDIO_H
+
+#include <stdatomic.h> //C11 atomics
+#include <SDL2/SDL.h>
+
+// Sound for the SDL frontend, a square wave made in the SDL audio callback while the sound timer is running.
+// The emulation thread only ever stores to the atomics below and the callback only loads them once per buffer,
+// so neither side waits on the other and the core never does audio or console I/O.
+// The wave is band limited (polyBLEP at each edge) so it doesn't alias into a buzz, and the volume ramps over a
+// couple of milliseconds when the tone starts and stops so there's no click.
+
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_BUFFER_SAMPLES 512 //about 10ms, short enough that a 60hz timer tick isn't noticeably late
+#define AUDIO_TONE_HZ 440 //original interpreters just buzzed, this is the usual choice
+#define AUDIO_RAMP_MS 2
+
+typedef struct {
+    atomic_int gate; //1 while the tone should play, written by the emulation thread
+    atomic_int toneHz; //pitch, only the default for now, XO-CHIP sets it from its pitch register
+    SDL_AudioDeviceID device; //0 if there's no audio, everything still works silently
+    float volume; //0 to 1
+    float phase; //callback only from here down, 0 to 1 through one cycle
+    float gain; //current envelope level, heads for volume or 0
+} audioOutput;
+
+int openAudio(audioOutput *a, float volume); //returns 0 on success, -1 if there's no audio device (a stays usable, just silent)
+static inline void setSound(audioOutput *a, int on) { //any thread, never blocks
+    atomic_store_explicit(&a->gate, on, memory_order_relaxed);
+}
+void closeAudio(audioOutput *a);
+
+#endif
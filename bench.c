@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h> //for unsignted ints
+#include <time.h> //clock_gettime
+#include "chip8.h" //emulator core, no SDL needed
+#ifdef CHIP8_JIT
+#include "jit.h" //rom benchmarks are run on the recompiler as well
+#endif
+#ifdef CHIP8_BENCH_SDL
+#include "render.h" //display and overlay text drawn into an offscreen renderer
+#endif
+
+// Benchmarks for the core and the frontend drawing code, results are written as JSON so runs can be compared across versions
+// micro benchmarks time one thing at a time (dispatch, DXYN at the screen edge under each sprite quirk, 00E0),
+// rom benchmarks run synthetic roms built below (ALU loops, draw storms, call/return chains, delay timer waits) the way the frontend does, instructions then a timer tick
+// every benchmark is run -r times and the fastest run is reported, the others are noise from the rest of the system
+// gcc -O2 bench.c chip8.c -o chip8bench
+// gcc -O2 -DCHIP8_JIT bench.c chip8.c jit.c -o chip8bench (rom benchmarks on the recompiler too)
+// gcc -O2 -DCHIP8_BENCH_SDL bench.c chip8.c render.c -o chip8bench -lSDL2 -lSDL2_ttf (display and text drawing, -f font.ttf)
+
+#define LOOP_LENGTH 64 //instructions per loop in the micro benchmark roms, 63 of the thing being timed and the jump back
+#define BENCH_IPF 1000 //instructions per frame for the rom benchmarks
+#define SPRITE_ADDRESS 0x300 //15 rows of solid sprite in every rom
+
+typedef struct {
+    uint8_t bytes[CHIP8_MAX_ROM_SIZE];
+    int size;
+    int prologue; //instructions before the loop starts, run before timing
+} romBuilder;
+
+typedef struct {
+    const char *name;
+    const char *kind; //micro or rom
+    void (*build)(romBuilder *rb);
+    int spriteWrapClipQuirk;
+    long long instructions; //per run, scaled by -s
+    int work; //timed units per LOOP_LENGTH instructions for micro benchmarks, 0 for rom benchmarks which count instructions
+    const char *unit;
+} benchmark;
+
+typedef struct {
+    FILE *out;
+    int count; //results written so far, for the commas
+    int repeats;
+} benchResults;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void emit(romBuilder *rb, uint16_t opcode) {
+    rb->bytes[rb->size++] = opcode >> 8;
+    rb->bytes[rb->size++] = opcode & 0xFF;
+}
+
+static uint16_t here(const romBuilder *rb) { //address the next emitted instruction will be at
+    return CHIP8_ROM_START + rb->size;
+}
+
+static void emitSprite(romBuilder *rb) { //solid 8x15 sprite at SPRITE_ADDRESS, after the code
+    memset(rb->bytes + (SPRITE_ADDRESS - CHIP8_ROM_START), 0xFF, 15);
+    if (rb->size < SPRITE_ADDRESS - CHIP8_ROM_START + 15) rb->size = SPRITE_ADDRESS - CHIP8_ROM_START + 15;
+}
+
+// micro benchmark roms, a short prologue then LOOP_LENGTH - 1 of the instruction being timed and a jump back
+
+static void buildDispatch(romBuilder *rb) { //cheap register ops so the time is mostly fetching and dispatching
+    static const uint16_t ops[] = { 0x7001, 0x6102, 0x8010, 0x7203, 0xA300, 0x8121, 0x7304, 0x6405, 0x8342 };
+    uint16_t loop = here(rb);
+    for (int i = 0; i < LOOP_LENGTH - 1; i++) {
+        emit(rb, ops[i % (sizeof(ops) / sizeof(ops[0]))]);
+    }
+    emit(rb, 0x1000 | loop);
+}
+
+static void buildEdgeSprite(romBuilder *rb) { //15 row sprite at 60,28 runs off the right and bottom edges, clipped or wrapped by the quirk
+    emit(rb, 0x603C); //V0 = 60
+    emit(rb, 0x611C); //V1 = 28
+    emit(rb, 0xA000 | SPRITE_ADDRESS);
+    rb->prologue = 3;
+    uint16_t loop = here(rb);
+    for (int i = 0; i < LOOP_LENGTH - 1; i++) {
+        emit(rb, 0xD01F);
+    }
+    emit(rb, 0x1000 | loop);
+    emitSprite(rb);
+}
+
+static void buildMiddleSprite(romBuilder *rb) { //same sprite not touching an edge, at an x that isn't a multiple of 8
+    emit(rb, 0x601B); //V0 = 27
+    emit(rb, 0x6108); //V1 = 8
+    emit(rb, 0xA000 | SPRITE_ADDRESS);
+    rb->prologue = 3;
+    uint16_t loop = here(rb);
+    for (int i = 0; i < LOOP_LENGTH - 1; i++) {
+        emit(rb, 0xD01F);
+    }
+    emit(rb, 0x1000 | loop);
+    emitSprite(rb);
+}
+
+static void buildClear(romBuilder *rb) {
+    uint16_t loop = here(rb);
+    for (int i = 0; i < LOOP_LENGTH - 1; i++) {
+        emit(rb, 0x00E0);
+    }
+    emit(rb, 0x1000 | loop);
+}
+
+// rom benchmarks, closer to what games do
+
+static void buildAluLoop(romBuilder *rb) { //counting loop with carries, borrows, shifts and a conditional skip
+    uint16_t outer = here(rb);
+    emit(rb, 0x6000); //V0 = 0, loop counter
+    emit(rb, 0x6101); //V1 = 1
+    emit(rb, 0x6207); //V2 = 7
+    uint16_t inner = here(rb);
+    emit(rb, 0x8314); //V3 += V1
+    emit(rb, 0x8425); //V4 -= V2
+    emit(rb, 0x8546); //V5 = V4 >> 1
+    emit(rb, 0x853E); //V5 <<= 1
+    emit(rb, 0x8632); //V6 &= V3
+    emit(rb, 0x8741); //V7 |= V4
+    emit(rb, 0x8853); //V8 ^= V5
+    emit(rb, 0x7001); //V0++
+    emit(rb, 0x30FF); //skip when V0 reaches 255
+    emit(rb, 0x1000 | inner);
+    emit(rb, 0x1000 | outer);
+}
+
+static void buildDrawStorm(romBuilder *rb) { //sprites all over the screen, random positions and heights, clearing every 256 draws
+    emit(rb, 0xA000 | SPRITE_ADDRESS);
+    uint16_t outer = here(rb);
+    emit(rb, 0x00E0);
+    emit(rb, 0x6200); //V2 = 0, draws since the clear
+    uint16_t inner = here(rb);
+    emit(rb, 0xC03F); //V0 = random 0-63
+    emit(rb, 0xC11F); //V1 = random 0-31
+    emit(rb, 0xD018);
+    emit(rb, 0x7005); //V0 += 5
+    emit(rb, 0x7103); //V1 += 3
+    emit(rb, 0xD01F); //taller one that often crosses an edge
+    emit(rb, 0x7201);
+    emit(rb, 0x3200); //skip back to the clear once V2 wraps to 0
+    emit(rb, 0x1000 | inner);
+    emit(rb, 0x1000 | outer);
+    emitSprite(rb);
+}
+
+static void buildCallChain(romBuilder *rb) { //main calls four levels deep, each level does a little work and calls the next
+    uint16_t loop = here(rb);
+    emit(rb, 0x2000); //patched below to call level 0
+    emit(rb, 0x7001);
+    emit(rb, 0x1000 | loop);
+    uint16_t levels[5];
+    int calls[4];
+    for (int level = 0; level < 4; level++) {
+        levels[level] = here(rb);
+        emit(rb, 0x7101 + level * 0x100); //V(level+1) += 1
+        calls[level] = rb->size;
+        emit(rb, 0x2000); //patched below to call the next level
+        emit(rb, 0x8010 | ((level + 1) << 4)); //V0 = V(level+1)
+        emit(rb, 0x00EE);
+    }
+    levels[4] = here(rb); //leaf
+    emit(rb, 0x7501);
+    emit(rb, 0x00EE);
+    uint16_t first = 0x2000 | levels[0];
+    rb->bytes[loop - CHIP8_ROM_START] = first >> 8;
+    rb->bytes[loop - CHIP8_ROM_START + 1] = first & 0xFF;
+    for (int level = 0; level < 4; level++) {
+        uint16_t call = 0x2000 | levels[level + 1];
+        rb->bytes[calls[level]] = call >> 8;
+        rb->bytes[calls[level] + 1] = call & 0xFF;
+    }
+}
+
+static void buildTimerWait(romBuilder *rb) { //sets the delay timer and polls it until it runs out, like most games between frames
+    uint16_t outer = here(rb);
+    emit(rb, 0x6003); //V0 = 3
+    emit(rb, 0xF015); //DT = V0
+    uint16_t wait = here(rb);
+    emit(rb, 0xF107); //V1 = DT
+    emit(rb, 0x3100); //skip when it reaches 0
+    emit(rb, 0x1000 | wait);
+    emit(rb, 0x7201); //a little work between waits
+    emit(rb, 0x1000 | outer);
+}
+
+static const benchmark benchmarks[] = {
+    { "dispatch", "micro", buildDispatch, 0, 50000000, LOOP_LENGTH, "instructions" }, //the jump back is dispatched like the rest
+    { "dxyn-edge-wrap", "micro", buildEdgeSprite, 0, 5000000, LOOP_LENGTH - 1, "sprites" },
+    { "dxyn-edge-clip", "micro", buildEdgeSprite, 1, 5000000, LOOP_LENGTH - 1, "sprites" },
+    { "dxyn-middle", "micro", buildMiddleSprite, 0, 5000000, LOOP_LENGTH - 1, "sprites" },
+    { "clear", "micro", buildClear, 0, 20000000, LOOP_LENGTH - 1, "clears" },
+    { "alu-loop", "rom", buildAluLoop, 0, 50000000, 0, "instructions" },
+    { "draw-storm", "rom", buildDrawStorm, 0, 10000000, 0, "instructions" },
+    { "draw-storm-clip", "rom", buildDrawStorm, 1, 10000000, 0, "instructions" },
+    { "call-chain", "rom", buildCallChain, 0, 50000000, 0, "instructions" },
+    { "timer-wait", "rom", buildTimerWait, 0, 50000000, 0, "instructions" },
+};
+
+enum { RUN_STEP, RUN_SINGLE, RUN_JIT }; //stepInstructions, fetchDecodeExecute one at a time, jitStepInstructions
+
+static const char *runNames[] = { "", "-single", "-jit" };
+
+static void setUp(chip8 *c8, const benchmark *b, const romBuilder *rb) {
+    c8->loadStoreRegQuirk = 0;
+    c8->spriteWrapClipQuirk = b->spriteWrapClipQuirk;
+    c8->bitShiftQuirk = 0;
+    initialiseSystem(c8);
+    loadROMBuffer(c8, rb->bytes, rb->size);
+    for (int i = 0; i < rb->prologue; i++) {
+        fetchDecodeExecute(c8);
+    }
+}
+
+static void runInstructions(chip8 *c8, int how, int count) {
+    if (how == RUN_SINGLE) {
+        for (int i = 0; i < count; i++) {
+            fetchDecodeExecute(c8);
+        }
+    }
+#ifdef CHIP8_JIT
+    else if (how == RUN_JIT) jitStepInstructions(c8, count);
+#endif
+    else stepInstructions(c8, count);
+}
+
+static double runOnce(chip8 *c8, const benchmark *b, const romBuilder *rb, int how, long long instructions) {
+    setUp(c8, b, rb);
+#ifdef CHIP8_JIT
+    if (how == RUN_JIT && jitCreate(c8) != 0) return -1;
+#endif
+    double start = now();
+    if (b->work) { //micro, no timer ticks so only the instruction being timed is in there
+        for (long long done = 0; done < instructions; done += LOOP_LENGTH * 1024) {
+            runInstructions(c8, how, LOOP_LENGTH * 1024);
+        }
+    } else {
+        for (long long done = 0; done < instructions; done += BENCH_IPF) {
+            runInstructions(c8, how, BENCH_IPF);
+            tickTimers(c8);
+        }
+    }
+    double seconds = now() - start;
+#ifdef CHIP8_JIT
+    if (how == RUN_JIT) jitDestroy(c8);
+#endif
+    return seconds;
+}
+
+static void writeResult(benchResults *r, const char *name, const char *kind, const char *unit, long long iterations, double best, double mean) {
+    fprintf(r->out, "%s\n    { \"name\": \"%s\", \"kind\": \"%s\", \"unit\": \"%s\", \"iterations\": %lld, \"repeats\": %d, \"bestSeconds\": %.6f, \"meanSeconds\": %.6f, \"perSecond\": %.1f }",
+        r->count ? "," : "", name, kind, unit, iterations, r->repeats, best, mean, iterations / best);
+    r->count++;
+    fprintf(stderr, "%-24s %14.0f %s/s\n", name, iterations / best, unit);
+}
+
+static void runBenchmark(benchResults *r, chip8 *c8, const benchmark *b, int how, double scale) {
+    static romBuilder rb;
+    memset(&rb, 0, sizeof(rb));
+    b->build(&rb);
+    long long instructions = (long long)(b->instructions * scale);
+    if (b->work) instructions -= instructions % (LOOP_LENGTH * 1024); //whole loops so the work count is exact
+    else instructions -= instructions % BENCH_IPF;
+    if (instructions <= 0) instructions = b->work ? LOOP_LENGTH * 1024 : BENCH_IPF;
+
+    double best = 0, total = 0;
+    for (int i = 0; i < r->repeats; i++) {
+        double seconds = runOnce(c8, b, &rb, how, instructions);
+        if (seconds < 0) return; //no recompiler on this platform
+        if (i == 0 || seconds < best) best = seconds;
+        total += seconds;
+    }
+    if (best <= 0) best = 1e-9;
+    char name[64];
+    snprintf(name, sizeof(name), "%s%s", b->name, runNames[how]);
+    long long iterations = b->work ? instructions / LOOP_LENGTH * b->work : instructions;
+    writeResult(r, name, b->kind, b->unit, iterations, best, total / r->repeats);
+}
+
+#ifdef CHIP8_BENCH_SDL
+// frontend drawing into a software renderer on a surface, no window so it runs anywhere SDL does
+// same window size and overlay layout as Chip8Emu.c at the default scale
+
+static void runDisplayBenchmark(benchResults *r, SDL_Renderer *renderer, displayRenderer *dr, const chip8 *c8, long frames) {
+    double best = 0, total = 0;
+    for (int i = 0; i < r->repeats; i++) {
+        double start = now();
+        for (long f = 0; f < frames; f++) {
+            drawDisplay(c8->display, c8->hires, renderer, dr);
+        }
+        double seconds = now() - start;
+        if (i == 0 || seconds < best) best = seconds;
+        total += seconds;
+    }
+    writeResult(r, "draw-display", "render", "frames", frames, best > 0 ? best : 1e-9, total / r->repeats);
+}
+
+static void runTextBenchmark(benchResults *r, SDL_Renderer *renderer, textRenderer *tr, long frames) {
+    SDL_Color white = {255, 255, 255, 255};
+    char buf[64];
+    double best = 0, total = 0;
+    for (int i = 0; i < r->repeats; i++) {
+        double start = now();
+        for (long f = 0; f < frames; f++) {
+            for (int v = 0; v < 16; v++) { //registers change every frame, so these get laid out again
+                sprintf(buf, "V%X: %02X", v, (int)((f + v) & 0xFF));
+                drawText(tr, 650, 10 + v * 20, buf, white);
+            }
+            for (int s = 0; s < 16; s++) { //stack mostly doesn't
+                sprintf(buf, "S%X: %04X", s, 0x200 + s * 2);
+                drawText(tr, 750, 10 + s * 20, buf, white);
+            }
+            sprintf(buf, "PC: %04X", (int)(0x200 + (f & 0xFFE)));
+            drawText(tr, 650, 360, buf, white);
+            drawText(tr, 300, 410, "Pause: spc Step: n", white);
+            flushText(tr, renderer);
+        }
+        double seconds = now() - start;
+        if (i == 0 || seconds < best) best = seconds;
+        total += seconds;
+    }
+    writeResult(r, "draw-text", "render", "frames", frames, best > 0 ? best : 1e-9, total / r->repeats);
+}
+
+static void runRenderBenchmarks(benchResults *r, chip8 *c8, const char *fontPath, double scale) {
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "SDL_Init: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, 900, 560, 32, SDL_PIXELFORMAT_ARGB8888); //window size at the default scale
+    SDL_Renderer *renderer = target ? SDL_CreateSoftwareRenderer(target) : NULL;
+    if (renderer == NULL) {
+        fprintf(stderr, "Failed to create offscreen renderer: %s\n", SDL_GetError());
+        SDL_Quit();
+        return;
+    }
+    long frames = (long)(20000 * scale);
+    if (frames < 1) frames = 1;
+
+    displayRenderer dr = { NULL, 10, 0xFFFFFFFF, 0xFF000000, 0xFFAAAAAA, 0xFF555555 };
+    if (createDisplayRenderer(&dr, renderer) == 0) {
+        static romBuilder rb; //something on the display worth drawing
+        memset(&rb, 0, sizeof(rb));
+        buildDrawStorm(&rb);
+        setUp(c8, &benchmarks[0], &rb);
+        stepInstructions(c8, 500);
+        runDisplayBenchmark(r, renderer, &dr, c8, frames);
+        SDL_DestroyTexture(dr.texture);
+    }
+
+    if (TTF_Init() == -1) {
+        fprintf(stderr, "TTF_Init: %s\n", TTF_GetError());
+    } else {
+        TTF_Font *font = TTF_OpenFont(fontPath, 16);
+        static textRenderer tr;
+        if (font == NULL) {
+            fprintf(stderr, "Failed to load font %s, skipping text benchmark: %s\n", fontPath, TTF_GetError());
+        } else if (createTextRenderer(&tr, renderer, font) == 0) {
+            TTF_CloseFont(font);
+            runTextBenchmark(r, renderer, &tr, frames);
+            SDL_DestroyTexture(tr.atlas);
+        } else {
+            TTF_CloseFont(font);
+        }
+        TTF_Quit();
+    }
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+    SDL_Quit();
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    const char *outPath = NULL;
+    const char *filter = NULL;
+    const char *fontPath = "arial.ttf";
+    int repeats = 5;
+    double scale = 1.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+            if (repeats < 1) repeats = 1;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            scale = atof(argv[++i]);
+            if (scale <= 0) scale = 1.0;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            fontPath = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-o results.json] [-r repeats] [-s scale] [-b name] [-f font.ttf]\n", argv[0]);
+            fprintf(stderr, "  -r  runs of each benchmark, the fastest is reported (default 5)\n");
+            fprintf(stderr, "  -s  multiply the work each benchmark does, e.g. 0.1 for a quick check\n");
+            fprintf(stderr, "  -b  only run benchmarks whose name contains this\n");
+            return 1;
+        }
+    }
+
+    benchResults r = { stdout, 0, repeats };
+    if (outPath) {
+        r.out = fopen(outPath, "w");
+        if (r.out == NULL) {
+            fprintf(stderr, "Failed to create %s\n", outPath);
+            return 1;
+        }
+    }
+    static chip8 machine;
+
+    fprintf(r.out, "{\n  \"format\": 1,\n  \"timestamp\": %lld,\n  \"build\": { \"jit\": %s, \"render\": %s },\n  \"benchmarks\": [",
+        (long long)time(NULL),
+#ifdef CHIP8_JIT
+        "true",
+#else
+        "false",
+#endif
+#ifdef CHIP8_BENCH_SDL
+        "true"
+#else
+        "false"
+#endif
+    );
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        const benchmark *b = &benchmarks[i];
+        if (filter && strstr(b->name, filter) == NULL) continue;
+        runBenchmark(&r, &machine, b, RUN_STEP, scale);
+        if (strcmp(b->name, "dispatch") == 0) {
+            runBenchmark(&r, &machine, b, RUN_SINGLE, scale); //how much the batched loop saves over one call per instruction
+        }
+#ifdef CHIP8_JIT
+        if (strcmp(b->kind, "rom") == 0 || strcmp(b->name, "dispatch") == 0) {
+            runBenchmark(&r, &machine, b, RUN_JIT, scale);
+        }
+#endif
+    }
+#ifdef CHIP8_BENCH_SDL
+    if (filter == NULL || strstr("draw-display draw-text", filter)) {
+        runRenderBenchmarks(&r, &machine, fontPath, scale);
+    }
+#else
+    (void)fontPath; //only the render benchmarks need a font
+#endif
+
+    fprintf(r.out, "\n  ]\n}\n");
+    if (r.out != stdout) fclose(r.out);
+    return 0;
+}
@@ -0,0 +1,1261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chip8.h"
+#ifdef CHIP8_JIT
+#include "jit.h" //so writes to memory can drop compiled blocks
+#endif
+#ifdef CHIP8_TRACE
+#include "trace.h" //records every instruction when a trace is running
+#endif
+#ifdef CHIP8_PROFILE
+#include "profile.h" //counts every instruction when profiling
+#endif
+
+// quirk dependent instructions are written once with the quirk as a parameter, the op_ functions pass the machine's flag
+// and the specialised interpreters pass a constant, always inlined so the check folds away there
+#if defined(__GNUC__)
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE static inline
+#endif
+
+static void invalidateDecoded(chip8 *c8, uint16_t address, int length) { //memory was written, throw away any predecoded instruction covering those bytes
+    for (int i = 0; i < length; i++) {
+        c8->decoded[((address + i) & 0xFFF) >> 1].handler = 0; //each byte is part of the instruction starting at the even address at or before it
+    }
+#ifdef CHIP8_JIT
+    if (c8->jit) jitInvalidate(c8, address, length);
+#endif
+}
+
+void flushDecodedCache(chip8 *c8) {
+    memset(c8->decoded, 0, sizeof(c8->decoded)); //nothing decoded yet
+#ifdef CHIP8_JIT
+    if (c8->jit) jitFlush(c8);
+#endif
+}
+
+void initialiseSystem(chip8 *c8) { //set all default values and sprites
+    memset(c8->mainMemory, 0, sizeof(c8->mainMemory));
+    flushDecodedCache(c8);
+    for (int i = 0; i < 16; i++) {
+        c8->regs.V[i] = 0; 
+    }
+    c8->regs.I = 0; 
+    c8->regs.DT = 0; 
+    c8->regs.ST = 0; 
+    c8->regs.PC = 0x200; // Program counter starts at 0x200
+    c8->regs.SP = 0; 
+    for (int i = 0; i < 16; i++) {
+        c8->stack[i] = 0; 
+    }
+    memset(c8->display, 0, sizeof(c8->display)); //set all display pixels to off
+    c8->displayGeneration++; //not reset, it only has to differ from what a frontend last drew
+    c8->hires = 0;
+    c8->planes = 1;
+    memset(c8->flags, 0, sizeof(c8->flags));
+    for (int i = 0; i < 16; i++) { //set all keys to not pressed
+        c8->keys[i] = 0; 
+    }
+    c8->rngState = CHIP8_DEFAULT_SEED; //fixed seed so every run gives the same random numbers, like unseeded rand() did
+    c8->keyWait = 0;
+  
+    uint8_t defaultSprites[80] = { // 5x8 sprites for 0-9, A-F, starting at 0x00
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0, top row first, last is bottom row
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, //7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, //8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, //9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+    };
+    uint8_t bigSprites[160] = { // 8x10 sprites for 0-F for FX30, starting at CHIP8_BIG_FONT
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+    };
+    for (int i = 0; i < 80; i++) {
+        c8->mainMemory[i] = defaultSprites[i]; // Put sprites into memory 0x00 to 0x4F
+    }
+    memcpy(&c8->mainMemory[CHIP8_BIG_FONT], bigSprites, sizeof(bigSprites)); // 0x50 to 0xEF
+    selectInterpreter(c8); //quirks may have been set since the last rom
+}
+
+void op_00E0(chip8 *c8) { // clear the selected planes
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        if (c8->planes & (1 << plane)) memset(c8->display[plane], 0, sizeof(c8->display[plane]));
+    }
+    c8->displayGeneration++;
+}
+
+// Scrolls move whole 64 bit words, rows up and down with memmove and 4 pixels left and right with a shift per word
+// carrying bits across into the next word in hires. They work on the selected planes in the current resolution.
+void op_00CN(chip8 *c8, uint8_t N) { // scroll down N rows, blank rows come in at the top
+    int height = displayHeight(c8);
+    if (N > height) N = height;
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        if (!(c8->planes & (1 << plane))) continue;
+        memmove(c8->display[plane][N], c8->display[plane][0], (height - N) * sizeof(c8->display[plane][0]));
+        memset(c8->display[plane][0], 0, N * sizeof(c8->display[plane][0]));
+    }
+    c8->displayGeneration++;
+}
+
+void op_00DN(chip8 *c8, uint8_t N) { // scroll up N rows (XO-CHIP)
+    int height = displayHeight(c8);
+    if (N > height) N = height;
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        if (!(c8->planes & (1 << plane))) continue;
+        memmove(c8->display[plane][0], c8->display[plane][N], (height - N) * sizeof(c8->display[plane][0]));
+        memset(c8->display[plane][height - N], 0, N * sizeof(c8->display[plane][0]));
+    }
+    c8->displayGeneration++;
+}
+
+void op_00FB(chip8 *c8) { // scroll right 4 pixels
+    int height = displayHeight(c8);
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        if (!(c8->planes & (1 << plane))) continue;
+        for (int y = 0; y < height; y++) {
+            uint64_t *row = c8->display[plane][y];
+            if (c8->hires) row[1] = (row[1] >> 4) | (row[0] << 60); //right word takes the 4 pixels pushed out of the left one
+            row[0] >>= 4;
+        }
+    }
+    c8->displayGeneration++;
+}
+
+void op_00FC(chip8 *c8) { // scroll left 4 pixels
+    int height = displayHeight(c8);
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        if (!(c8->planes & (1 << plane))) continue;
+        for (int y = 0; y < height; y++) {
+            uint64_t *row = c8->display[plane][y];
+            row[0] <<= 4;
+            if (c8->hires) {
+                row[0] |= row[1] >> 60;
+                row[1] <<= 4;
+            }
+        }
+    }
+    c8->displayGeneration++;
+}
+
+void op_00FD(chip8 *c8) { // exit, stays on this instruction so nothing else runs until the machine is reset
+    c8->regs.PC -= 2;
+}
+
+void op_00FE(chip8 *c8) { // lores 64x32, clears the display like XO-CHIP
+    c8->hires = 0;
+    memset(c8->display, 0, sizeof(c8->display));
+    c8->displayGeneration++;
+}
+
+void op_00FF(chip8 *c8) { // hires 128x64, clears the display
+    c8->hires = 1;
+    memset(c8->display, 0, sizeof(c8->display));
+    c8->displayGeneration++;
+}
+
+void op_00EE(chip8 *c8) { // return from subroutine
+    if (c8->regs.SP > 0) {
+        c8->regs.PC = c8->stack[--c8->regs.SP]; //decrement SP by 1 and set PC
+    } else {
+        printf("Stack underflow\n");
+    }
+}
+
+void op_0NNN(chip8 *c8, uint16_t NNN) { // call machine code routine on the original hardware, nothing to run it on here
+    (void)c8;
+    (void)NNN;
+    printf("Opcode not implemented\n");
+}
+
+void op_1NNN(chip8 *c8, uint16_t NNN) { // jump to address NNN
+    c8->regs.PC = NNN; // set PC to NNN
+}
+
+void op_2NNN(chip8 *c8, uint16_t NNN) { // call subroutine at NNN
+    if (c8->regs.SP < 15) {
+        c8->stack[c8->regs.SP++] = c8->regs.PC; // push current PC onto stack and increment SP
+        c8->regs.PC = NNN; // set PC to NNN
+    } else {
+        printf("Stack overflow\n");
+    }
+}
+
+void op_3XNN(chip8 *c8, uint8_t X, uint8_t NN) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X equals NN
+    if (c8->regs.V[X] == NN) {
+        c8->regs.PC += 2; 
+    }
+}
+
+void op_4XNN(chip8 *c8, uint8_t X, uint8_t NN) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X does not equal NN
+    if (c8->regs.V[X] != NN) {
+        c8->regs.PC += 2;
+    }
+}
+
+void op_5XY0(chip8 *c8, uint8_t X, uint8_t Y) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X equals register Y
+    if (c8->regs.V[X] == c8->regs.V[Y]) {
+        c8->regs.PC += 2;
+    }
+}
+
+void op_5XY2(chip8 *c8, uint8_t X, uint8_t Y) { // store VX to VY in memory at I, either direction, I doesn't change (XO-CHIP)
+    int step = X <= Y ? 1 : -1;
+    int length = X <= Y ? Y - X + 1 : X - Y + 1;
+    for (int i = 0; i < length; i++) {
+        c8->mainMemory[(c8->regs.I + i) & 0xFFF] = c8->regs.V[X + i * step];
+    }
+    invalidateDecoded(c8, c8->regs.I, length);
+}
+
+void op_5XY3(chip8 *c8, uint8_t X, uint8_t Y) { // load VX to VY from memory at I, either direction (XO-CHIP)
+    int step = X <= Y ? 1 : -1;
+    int length = X <= Y ? Y - X + 1 : X - Y + 1;
+    for (int i = 0; i < length; i++) {
+        c8->regs.V[X + i * step] = c8->mainMemory[(c8->regs.I + i) & 0xFFF];
+    }
+}
+
+void op_6XNN(chip8 *c8, uint8_t X, uint8_t NN) { //set register X to NN
+    c8->regs.V[X] = NN;
+}
+
+void op_7XNN(chip8 *c8, uint8_t X, uint8_t NN) { //add NN to register X, C overflow matches Chip-8 spec for register overflow (Modulo 256 for values larger than 255)
+    c8->regs.V[X] += NN;
+}
+
+void op_8XY0(chip8 *c8, uint8_t X, uint8_t Y) { //set register X to register Y
+    c8->regs.V[X] = c8->regs.V[Y];
+}
+
+void op_8XY1(chip8 *c8, uint8_t X, uint8_t Y) { //set register X to register X OR register Y
+    c8->regs.V[X] |= c8->regs.V[Y];
+}
+
+void op_8XY2(chip8 *c8, uint8_t X, uint8_t Y) { //set register X to register X AND register Y
+    c8->regs.V[X] &= c8->regs.V[Y];
+}
+
+void op_8XY3(chip8 *c8, uint8_t X, uint8_t Y) { //set register X to register X XOR register Y
+    c8->regs.V[X] ^= c8->regs.V[Y];
+}
+
+void op_8XY4(chip8 *c8, uint8_t X, uint8_t Y) { //add register Y to register X, set VF to 1 if overflow, 0 if not, do flag first then register or leads to bugs
+    uint16_t sum = c8->regs.V[X] + c8->regs.V[Y];
+    if (sum > 255) {
+        c8->regs.V[0xF] = 1; //1 for overflow
+    } else {
+        c8->regs.V[0xF] = 0; //0 for no overflow
+    }
+    c8->regs.V[X] = c8->regs.V[X] + c8->regs.V[Y]; //C does wrap around if overflow occurs, could also mask sum with 0xFF or sum mod 256
+}
+
+void op_8XY5(chip8 *c8, uint8_t X, uint8_t Y) { //subtract register Y from register X, set VF to 1 if no borrow, 0 if borrow
+    if (c8->regs.V[X] > c8->regs.V[Y]) {
+        c8->regs.V[0xF] = 1; //no borrow
+    } else {
+        c8->regs.V[0xF] = 0; //borrow
+    }
+    c8->regs.V[X] -= c8->regs.V[Y];
+}
+
+ALWAYS_INLINE void shiftRight(chip8 *c8, uint8_t X, uint8_t Y, int bitShiftQuirk) { //based on if bitShiftQuirk set to 0 or non 0
+    if (bitShiftQuirk == 0) { //register X = register Y >> 1, set VF to least significant bit of register Y, bitShiftQuirk= 0
+        c8->regs.V[0xF] = c8->regs.V[Y] & 0x01; //set VF to least significant bit of VY
+        c8->regs.V[X] = c8->regs.V[Y] >> 1; //set VX to VY shifted right by 1
+    }
+    else { //register X = register X >> 1, set VF to least significant bit of register X, bitShiftQuirk = non 0
+        c8->regs.V[0xF] = c8->regs.V[X] & 0x01; //set VF to least significant bit of VX
+        c8->regs.V[X] = c8->regs.V[X] >> 1; //set VX to VX shifted right by 1
+    }
+}
+
+void op_8XY6(chip8 *c8, uint8_t X, uint8_t Y) {
+    shiftRight(c8, X, Y, c8->bitShiftQuirk);
+}
+
+void op_8XY7(chip8 *c8, uint8_t X, uint8_t Y) { //set register X to register Y - register X, set VF to 1 if no borrow, 0 if borrow
+    if (c8->regs.V[Y] > c8->regs.V[X]) {
+        c8->regs.V[0xF] = 1; //no borrow
+    } else {
+        c8->regs.V[0xF] = 0; //borrow
+    }
+    c8->regs.V[X] = c8->regs.V[Y] - c8->regs.V[X];
+}
+
+ALWAYS_INLINE void shiftLeft(chip8 *c8, uint8_t X, uint8_t Y, int bitShiftQuirk) { //based on if bitShiftQuirk set to 0 or non 0
+    if(bitShiftQuirk == 0){ //register X = register Y << 1, set VF to most significant bit of register Y, bitShiftQuirk - 0
+        c8->regs.V[0xF] = c8->regs.V[Y] >> 7; //set VF to most significant bit of VY
+        c8->regs.V[X] = c8->regs.V[Y] << 1; //set VX to VY shift left by 1
+    }
+    else{ //register X = register X << 1, set VF to most significant bit of register X, bitShiftQuirk = non 0
+        c8->regs.V[0xF] = c8->regs.V[X] >> 7; //set VF to most significant bit of VX
+        c8->regs.V[X] = c8->regs.V[X] << 1; //shift VX left by 1
+    }
+}
+
+void op_8XYE(chip8 *c8, uint8_t X, uint8_t Y) {
+    shiftLeft(c8, X, Y, c8->bitShiftQuirk);
+}
+
+void op_9XY0(chip8 *c8, uint8_t X, uint8_t Y) { //skip next instruction (skip memory address, +2 PC, skip 16 bits) if register X does not equal register Y
+    if (c8->regs.V[X] != c8->regs.V[Y]) {
+        c8->regs.PC += 2;
+    }
+}
+
+void op_ANNN(chip8 *c8, uint16_t NNN) { //set index register I to NNN
+    c8->regs.I = NNN;
+}
+
+void op_BNNN(chip8 *c8, uint16_t NNN) { // jump to address NNN + V0
+    c8->regs.PC = NNN + c8->regs.V[0];
+}
+
+void op_CXNN(chip8 *c8, uint8_t X, uint8_t NN) { //set register X to random number AND NN
+    uint32_t x = c8->rngState; //xorshift32, state is per machine so it can be saved and restored
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c8->rngState = x;
+    uint8_t randomByte = x >> 24; // Generate a random byte (0-255), top bits are the most random
+    c8->regs.V[X] = randomByte & NN; // AND with NN
+}
+
+ALWAYS_INLINE void drawSprite(chip8 *c8, uint8_t X, uint8_t Y, uint8_t N, int spriteWrapClipQuirk) { // draw sprite from address I at (V[X], V[Y] corresponding to top left most pixel) with height N(top level, top level - N), N of 0 is a 16x16 sprite
+    c8->regs.V[0xF] = 0; //set register VF to 0 initially when no collision
+    c8->displayGeneration++; //a sprite that collides everywhere changes the display too, no point working out if it didn't
+    if (!c8->hires && c8->planes == 1 && N != 0) { //plain CHIP-8, nearly every draw, one word a row in one plane
+        int firstX = c8->regs.V[X] & (CHIP8_DISPLAY_WIDTH - 1);
+        int firstY = c8->regs.V[Y] & (CHIP8_DISPLAY_HEIGHT - 1);
+        uint64_t collided = 0;
+        for (int i = 0; i < N; i++) {
+            int currentY = firstY + i;
+            if (currentY >= CHIP8_DISPLAY_HEIGHT) {
+                if (spriteWrapClipQuirk != 0) break;
+                currentY -= CHIP8_DISPLAY_HEIGHT;
+            }
+            uint64_t spriteRow = (uint64_t)c8->mainMemory[(c8->regs.I + i) & 0xFFF] << 56;
+            uint64_t bits = spriteWrapClipQuirk != 0 ? spriteRow >> firstX : (spriteRow >> firstX) | (spriteRow << ((64 - firstX) & 63)); //same clip or rotate as below
+            collided |= c8->display[0][currentY][0] & bits;
+            c8->display[0][currentY][0] ^= bits;
+        }
+        c8->regs.V[0xF] = collided != 0;
+        return;
+    }
+    int width = c8->hires ? CHIP8_HIRES_WIDTH : CHIP8_DISPLAY_WIDTH;
+    int height = c8->hires ? CHIP8_HIRES_HEIGHT : CHIP8_DISPLAY_HEIGHT;
+    //first bit always on screen somewhere
+    int firstX = c8->regs.V[X] & (width - 1); //wraparound X if needed for initial X coord
+    int firstY = c8->regs.V[Y] & (height - 1); //wraparound Y if needed for initial Y coord
+    int wide = N == 0; //16 pixels wide, two bytes a row
+    int rows = wide ? 16 : N;
+    uint16_t address = c8->regs.I;
+
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) { //each selected plane takes the next sprite's worth of bytes
+        if (!(c8->planes & (1 << plane))) continue;
+        for(int i = 0; i < rows; i++){ //get each row of the sprite down to height top - N (sprites starts at lowest address)
+            int currentY = firstY + i;
+            if (currentY >= height) {
+                if (spriteWrapClipQuirk != 0) break; //clip sprite if spriteWrapClipQuirk != 0, rest of the rows are off the bottom too
+                currentY -= height; //wraparound if needed
+            }
+            uint64_t spriteRow; //row of 8 or 16 bits lined up with the leftmost pixel of the display row, addresses wrap at 4k so bad I can't read outside memory
+            if (wide) {
+                spriteRow = (uint64_t)c8->mainMemory[(address + 2 * i) & 0xFFF] << 56 | (uint64_t)c8->mainMemory[(address + 2 * i + 1) & 0xFFF] << 48;
+            } else {
+                spriteRow = (uint64_t)c8->mainMemory[(address + i) & 0xFFF] << 56;
+            }
+            uint64_t *row = c8->display[plane][currentY];
+
+            //move the whole row to firstX in one go, bits past the right edge either wrapped around or clipped depending on spriteWrapClipQuirk value
+            uint64_t collided;
+            if (!c8->hires) { //one word a row
+                uint64_t bits;
+                if (spriteWrapClipQuirk != 0) {
+                    bits = spriteRow >> firstX; //clip, bits shifted off the right are gone
+                } else {
+                    bits = (spriteRow >> firstX) | (spriteRow << ((64 - firstX) & 63)); //rotate, bits off the right come back on the left
+                }
+                collided = row[0] & bits; //collision if any pixel is on in both, ie would turn off when XOR'ed
+                row[0] ^= bits; //XOR whole row at once and update display with result
+            } else { //two words a row, the sprite can straddle them
+                int word = firstX >> 6;
+                int shift = firstX & 63;
+                uint64_t inWord = spriteRow >> shift;
+                uint64_t spill = shift ? spriteRow << (64 - shift) : 0; //bits that carry on into the next word
+                int next = word ^ 1; //off the right of the second word wraps to the first
+                if (word == 1 && spriteWrapClipQuirk != 0) spill = 0;
+                collided = (row[word] & inWord) | (row[next] & spill);
+                row[word] ^= inWord;
+                row[next] ^= spill;
+            }
+            if (collided) {
+                c8->regs.V[0xF] = 1;
+            }
+        }
+        address += wide ? 32 : N;
+    }
+}
+
+void op_DXYN(chip8 *c8, uint8_t X, uint8_t Y, uint8_t N) {
+    drawSprite(c8, X, Y, N, c8->spriteWrapClipQuirk);
+}
+   
+void op_EX9E(chip8 *c8, uint8_t X) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if key with value of register X is pressed
+    if (c8->keys[c8->regs.V[X] & 0xF] == 1) { //key pressed if value is 1, only the low 4 bits pick a key so big values can't read past keys
+        c8->regs.PC += 2;
+    }
+}
+
+void op_EXA1(chip8 *c8, uint8_t X) { // skip next instruction (skip memory address, +2 PC, skip 16 bits) if key with value of register X is not pressed
+    if (c8->keys[c8->regs.V[X] & 0xF] == 0) { //key not pressed if value is 0
+        c8->regs.PC += 2;
+    }
+}
+
+void op_FX07(chip8 *c8, uint8_t X) { // set register X to value of delay timer
+    c8->regs.V[X] = c8->regs.DT;
+}
+
+void op_FX0A(chip8 *c8, uint8_t X) { // wait for a key to be pressed and released, then set register X to that key
+    c8->keyWait = CHIP8_KEY_WAIT_PRESS; //no more instructions run until setKey finishes the wait, PC is already on the next one
+    c8->keyWaitRegister = X;
+    c8->keyWaitKey = 0;
+    c8->keyWaitHeld = 0;
+    for (int i = 0; i < 16; i++) { //keys already down don't count, they have to be let go and pressed again
+        if (c8->keys[i]) c8->keyWaitHeld |= 1 << i;
+    }
+}
+
+void seedRandom(chip8 *c8, uint32_t seed) {
+    c8->rngState = seed ? seed : CHIP8_DEFAULT_SEED; //xorshift gets stuck on 0
+}
+
+void setKey(chip8 *c8, int key, int pressed) {
+    key &= 0xF;
+    c8->keys[key] = pressed != 0;
+    if (c8->keyWait == CHIP8_KEY_WAIT_PRESS) {
+        if (!pressed) {
+            c8->keyWaitHeld &= ~(1 << key); //held from before FX0A, counts next time it goes down
+        } else if (!(c8->keyWaitHeld & (1 << key))) {
+            c8->keyWait = CHIP8_KEY_WAIT_RELEASE; //like the original interpreter the key is taken when it's let go
+            c8->keyWaitKey = key;
+        }
+    } else if (c8->keyWait == CHIP8_KEY_WAIT_RELEASE && !pressed && key == c8->keyWaitKey) {
+        c8->regs.V[c8->keyWaitRegister] = key;
+        c8->keyWait = 0; //carry on from the instruction after FX0A
+    }
+}
+
+void op_FX15(chip8 *c8, uint8_t X) { // set delay timer to value of register X
+    c8->regs.DT = c8->regs.V[X];
+}
+
+void op_FX18(chip8 *c8, uint8_t X) { // set sound timer to value of register X
+    c8->regs.ST = c8->regs.V[X];
+}
+
+void op_FX1E(chip8 *c8, uint8_t X) { // add value of register X to index register I
+    c8->regs.I += c8->regs.V[X]; //value x mod 4096 since 16bit register
+}      
+
+void op_FX29(chip8 *c8, uint8_t X) { // set index register I to location of sprite for digit in register X
+    if (c8->regs.V[X] < 16) { // ensure X is a valid digit (0-15)
+        c8->regs.I = c8->regs.V[X] * 5; // sprites are 5 bytes from 0x00 to 0x4F
+    } else {
+        printf("Invalid digit in register V[%d]: %d\n", X, c8->regs.V[X]);
+    }
+}
+
+void op_FX30(chip8 *c8, uint8_t X) { // set index register I to the 8x10 sprite for digit in register X (SCHIP)
+    c8->regs.I = CHIP8_BIG_FONT + (c8->regs.V[X] & 0xF) * 10; //only the low 4 bits pick a digit, same as XO-CHIP
+}
+
+void op_FX75(chip8 *c8, uint8_t X) { // save V0 to VX in the RPL flags (SCHIP, XO-CHIP allows all 16)
+    memcpy(c8->flags, c8->regs.V, X + 1);
+}
+
+void op_FX85(chip8 *c8, uint8_t X) { // load V0 to VX from the RPL flags
+    memcpy(c8->regs.V, c8->flags, X + 1);
+}
+
+void op_FN01(chip8 *c8, uint8_t N) { // select the planes drawing, scrolling and clearing work on (XO-CHIP), N is a bit per plane
+    c8->planes = N & ((1 << CHIP8_PLANES) - 1);
+}
+
+void op_FX33(chip8 *c8, uint8_t X) { // store BCD representation of value in register X at I, I+1, I+2
+    uint8_t value = c8->regs.V[X];
+    c8->mainMemory[c8->regs.I & 0xFFF] = value / 100; // integer division for 100 digit, addresses wrap at 4k so bad I can't write outside memory
+    c8->mainMemory[(c8->regs.I + 2) & 0xFFF] = value % 10; // one digit
+    c8->mainMemory[(c8->regs.I + 1) & 0xFFF] = (value / 10) % 10; // tens digit
+    invalidateDecoded(c8, c8->regs.I, 3);
+}
+
+ALWAYS_INLINE void storeRegisters(chip8 *c8, uint8_t X, int loadStoreRegQuirk) { // store registers V0 to VX inclusive in memory starting at address I
+    for (int i = 0; i <= X; i++) {
+        c8->mainMemory[(c8->regs.I + i) & 0xFFF] = c8->regs.V[i]; //wrap at 4k
+    }
+    invalidateDecoded(c8, c8->regs.I, X + 1);
+    if(loadStoreRegQuirk == 0){
+        c8->regs.I += X + 1; // increment I by X + 1 after
+    } //if loadStoreRegQuirk == 0 then set reg I to I+X+1 after, otherwise reg I stays the same after the instruction if loadStoreRegQuirk == non 0
+}
+
+void op_FX55(chip8 *c8, uint8_t X) {
+    storeRegisters(c8, X, c8->loadStoreRegQuirk);
+}
+
+ALWAYS_INLINE void loadRegisters(chip8 *c8, uint8_t X, int loadStoreRegQuirk) { // read registers V0 to VX inclusive from memory starting at address I
+    for (int i = 0; i <= X; i++) {
+        c8->regs.V[i] = c8->mainMemory[(c8->regs.I + i) & 0xFFF]; //wrap at 4k
+    }
+    if(loadStoreRegQuirk == 0){
+        c8->regs.I += X + 1; // increment I by X + 1 after
+    } //if loadStoreRegQuirk == 0 then set reg I to I+X+1 after, otherwise reg I stays the same after the instruction if loadStoreRegQuirk == non 0
+
+}
+
+void op_FX65(chip8 *c8, uint8_t X) {
+    loadRegisters(c8, X, c8->loadStoreRegQuirk);
+}
+
+void decode(chip8 *c8, uint16_t opcode) {
+    uint8_t firstFourBits = opcode >> 12;
+    uint16_t NNN = opcode & 0x0FFF; // Extract NNN
+    uint8_t NN = opcode & 0x00FF; // Extract NN
+    uint8_t N = opcode & 0x000F; // Extract N
+    uint8_t X = (opcode & 0x0F00) >> 8; // Extract X
+    uint8_t Y = (opcode & 0x00F0) >> 4; // Extract Y
+    
+    switch (firstFourBits) {
+        case 0x0: {
+            if (opcode == 0x00E0) {
+                op_00E0(c8);
+            } else if (opcode == 0x00EE) {
+                op_00EE(c8);
+            } else if ((opcode & 0xFFF0) == 0x00C0) {
+                op_00CN(c8, N);
+            } else if ((opcode & 0xFFF0) == 0x00D0) {
+                op_00DN(c8, N);
+            } else if (opcode == 0x00FB) {
+                op_00FB(c8);
+            } else if (opcode == 0x00FC) {
+                op_00FC(c8);
+            } else if (opcode == 0x00FD) {
+                op_00FD(c8);
+            } else if (opcode == 0x00FE) {
+                op_00FE(c8);
+            } else if (opcode == 0x00FF) {
+                op_00FF(c8);
+            } else {
+                op_0NNN(c8, NNN);
+            }
+            break;
+        }
+        case 0x1: {
+            op_1NNN(c8, NNN);
+            break;
+        }
+        case 0x2: {
+            op_2NNN(c8, NNN);
+            break;
+        }
+        case 0x3: {
+            op_3XNN(c8, X,NN);
+            break;
+        }
+        case 0x4: {
+            op_4XNN(c8, X,NN);
+            break;
+        }
+        case 0x5: {
+            if (N == 0) op_5XY0(c8, X, Y);
+            else if (N == 2) op_5XY2(c8, X, Y);
+            else if (N == 3) op_5XY3(c8, X, Y);
+            else printf("Unknown opcode: 0x%04X\n", opcode);
+            break;
+        }
+        case 0x6: {
+            op_6XNN(c8, X, NN);
+            break;
+        }
+        case 0x7: {
+            op_7XNN(c8, X, NN);
+            break;
+        }
+        case 0x8: {
+            if (N == 0) {
+                op_8XY0(c8, X, Y);
+            }
+            else if (N == 1) {
+                op_8XY1(c8, X, Y);
+            } else if (N == 2) {
+                op_8XY2(c8, X, Y);
+            } else if (N == 3) {
+                op_8XY3(c8, X, Y);
+            } else if (N == 4) {
+                op_8XY4(c8, X, Y);
+            } else if (N == 5) {
+                op_8XY5(c8, X, Y);
+            } else if (N == 6) { //bitShiftQuirk handled inside actual instruction
+                op_8XY6(c8, X,Y);
+            } else if (N == 7) {
+                op_8XY7(c8, X, Y);
+            } else if (N == 0xE) { //bitShiftQuirk handled inside actual instruction
+                op_8XYE(c8, X, Y);
+            } else {
+                printf("Unknown opcode: 0x%04X\n", opcode);
+            }
+            break;
+        }
+        case 0x9: {
+            if (N == 0) op_9XY0(c8, X, Y);
+            else printf("Unknown opcode: 0x%04X\n", opcode);
+            break;
+        }
+        case 0xA: {
+            op_ANNN(c8, NNN);
+            break;
+        }   
+        case 0xB: {
+            op_BNNN(c8, NNN);
+            break;
+        }
+        case 0xC: {
+            op_CXNN(c8, X, NN);
+            break;
+        }
+        case 0xD: {
+            op_DXYN(c8, X, Y, N); // clip or wrap Quirk handled in instruction, N of 0 is 16x16
+            break;
+        }
+        case 0xE: {
+            if (NN == 0x9E) {
+                op_EX9E(c8, X);
+            } else if (NN == 0xA1) {
+                op_EXA1(c8, X);
+            } else {
+                printf("Unknown opcode: 0x%04X\n", opcode);
+            }
+            break;
+        }
+        case 0xF: {
+            if (NN == 0x01) {
+                op_FN01(c8, X);
+            } else if (NN == 0x07) {
+                op_FX07(c8, X);
+            } else if (NN == 0x0A) {
+                op_FX0A(c8, X);
+            } else if (NN == 0x15) {
+                op_FX15(c8, X);
+            } else if (NN == 0x18) {
+                op_FX18(c8, X);
+            } else if (NN == 0x1E) {
+                op_FX1E(c8, X);
+            } else if (NN == 0x29) {
+                op_FX29(c8, X);
+            } else if (NN == 0x30) {
+                op_FX30(c8, X);
+            } else if (NN == 0x33) {
+                op_FX33(c8, X);
+            } else if (NN == 0x55) { //loadStoreRegQuirk handled inside instruction
+                op_FX55(c8, X);
+            } else if (NN == 0x65) { //loadStoreRegQuirk handled inside instruction
+                op_FX65(c8, X);
+            } else if (NN == 0x75) {
+                op_FX75(c8, X);
+            } else if (NN == 0x85) {
+                op_FX85(c8, X);
+            } else {
+                printf("Unknown opcode: 0x%04X\n", opcode);
+            }
+            break;
+        }
+        default: {
+            printf("Unknown opcode: 0x%04X\n", opcode);
+            break;
+        }
+    }
+}
+
+static inline int instrumented(const chip8 *c8) { //always 0 unless built with CHIP8_TRACE or CHIP8_PROFILE
+    int on = 0;
+#ifdef CHIP8_TRACE
+    on |= c8->trace != NULL;
+#endif
+#ifdef CHIP8_PROFILE
+    on |= c8->profile != NULL;
+#endif
+    (void)c8;
+    return on;
+}
+
+void fetchDecodeExecute(chip8 *c8){
+    if (c8->keyWait) return; //stopped on FX0A until setKey ends the wait
+    uint16_t instruction = (c8->mainMemory[c8->regs.PC & 0xFFF] << 8) | c8->mainMemory[(c8->regs.PC + 1) & 0xFFF]; //fetch each 8 bit half of instruction and concatanate, big Endian for instructions
+    c8->lastInstruction = instruction; // store current instruction
+#ifdef CHIP8_PROFILE
+    if (c8->profile) profileInstruction(c8->profile, c8->regs.PC, instruction); //before it runs, calls and returns need the PC they were made from
+#endif
+#ifdef CHIP8_TRACE
+    if (c8->trace) {
+        uint16_t pc = c8->regs.PC;
+        uint8_t before[16]; //to work out which registers the instruction changed
+        memcpy(before, c8->regs.V, 16);
+        c8->regs.PC += 2;
+        decode(c8, instruction);
+        traceInstruction(c8->trace, pc, instruction, before, c8);
+        return;
+    }
+#endif
+    c8->regs.PC += 2; //set PC to next sequential instruction, executed instruction can change this potentially
+    decode(c8, instruction); //decode into opcode and operand and execute
+}
+
+int loadROMBuffer(chip8 *c8, const uint8_t *rom, size_t size) { //copy rom bytes into memory, rom has already been read by the frontend (file, network etc)
+    if (size > CHIP8_MAX_ROM_SIZE) { //make sure rom isn't bigger than memory
+        return -1;
+    }
+    memcpy(&c8->mainMemory[CHIP8_ROM_START], rom, size);
+    invalidateDecoded(c8, CHIP8_ROM_START, (int)size);
+    selectInterpreter(c8);
+    return 0;
+}
+
+enum { //handlers for predecoded instructions, order must match the dispatch table in stepInstructions
+    H_UNDECODED = 0, H_00E0, H_00EE, H_0NNN, H_1NNN, H_2NNN, H_3XNN, H_4XNN, H_5XY0, H_6XNN, H_7XNN,
+    H_8XY0, H_8XY1, H_8XY2, H_8XY3, H_8XY4, H_8XY5, H_8XY6, H_8XY7, H_8XYE, H_9XY0,
+    H_ANNN, H_BNNN, H_CXNN, H_DXYN, H_EX9E, H_EXA1,
+    H_FX07, H_FX0A, H_FX15, H_FX18, H_FX1E, H_FX29, H_FX33, H_FX55, H_FX65,
+    H_00CN, H_00DN, H_00FB, H_00FC, H_00FD, H_00FE, H_00FF, H_5XY2, H_5XY3, H_DXY0, H_FN01, H_FX30, H_FX75, H_FX85, //SCHIP and XO-CHIP
+    H_UNKNOWN,
+    H_IDLE_LOOP, //only made by predecode, never by handlerFor: a 1NNN closing a short loop that polls the delay timer or keys, or jumps to itself
+    H_BREAK, //only made by predecode, an instruction with an address or opcode class breakpoint on it
+    H_COUNT
+};
+_Static_assert(H_UNKNOWN + 1 == CHIP8_OPCODE_CLASSES, "CHIP8_OPCODE_CLASSES in chip8.h must match the handler list");
+
+static uint8_t handlerFor(uint16_t opcode) { //same decisions as decode() but returns which handler instead of running it
+    uint8_t N = opcode & 0x000F;
+    uint8_t NN = opcode & 0x00FF;
+    switch (opcode >> 12) {
+        case 0x0: {
+            switch (opcode) {
+                case 0x00E0: return H_00E0;
+                case 0x00EE: return H_00EE;
+                case 0x00FB: return H_00FB;
+                case 0x00FC: return H_00FC;
+                case 0x00FD: return H_00FD;
+                case 0x00FE: return H_00FE;
+                case 0x00FF: return H_00FF;
+            }
+            if ((opcode & 0xFFF0) == 0x00C0) return H_00CN;
+            if ((opcode & 0xFFF0) == 0x00D0) return H_00DN;
+            return H_0NNN;
+        }
+        case 0x1: return H_1NNN;
+        case 0x2: return H_2NNN;
+        case 0x3: return H_3XNN;
+        case 0x4: return H_4XNN;
+        case 0x5: return N == 0 ? H_5XY0 : N == 2 ? H_5XY2 : N == 3 ? H_5XY3 : H_UNKNOWN;
+        case 0x6: return H_6XNN;
+        case 0x7: return H_7XNN;
+        case 0x8: {
+            static const uint8_t aluHandlers[16] = {
+                H_8XY0, H_8XY1, H_8XY2, H_8XY3, H_8XY4, H_8XY5, H_8XY6, H_8XY7,
+                H_UNKNOWN, H_UNKNOWN, H_UNKNOWN, H_UNKNOWN, H_UNKNOWN, H_UNKNOWN, H_8XYE, H_UNKNOWN
+            };
+            return aluHandlers[N];
+        }
+        case 0x9: return N == 0 ? H_9XY0 : H_UNKNOWN;
+        case 0xA: return H_ANNN;
+        case 0xB: return H_BNNN;
+        case 0xC: return H_CXNN;
+        case 0xD: return N == 0 ? H_DXY0 : H_DXYN;
+        case 0xE: return NN == 0x9E ? H_EX9E : NN == 0xA1 ? H_EXA1 : H_UNKNOWN;
+        default: {
+            switch (NN) {
+                case 0x01: return H_FN01;
+                case 0x07: return H_FX07;
+                case 0x0A: return H_FX0A;
+                case 0x15: return H_FX15;
+                case 0x18: return H_FX18;
+                case 0x1E: return H_FX1E;
+                case 0x29: return H_FX29;
+                case 0x30: return H_FX30;
+                case 0x33: return H_FX33;
+                case 0x55: return H_FX55;
+                case 0x65: return H_FX65;
+                case 0x75: return H_FX75;
+                case 0x85: return H_FX85;
+                default: return H_UNKNOWN;
+            }
+        }
+    }
+}
+
+int opcodeClass(uint16_t opcode) {
+    return handlerFor(opcode);
+}
+
+const char *opcodeClassName(int opcodeClass) {
+    static const char *const names[CHIP8_OPCODE_CLASSES] = {
+        "----", "00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+        "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0",
+        "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+        "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+        "00CN", "00DN", "00FB", "00FC", "00FD", "00FE", "00FF", "5XY2", "5XY3", "DXY0", "FN01", "FX30", "FX75", "FX85", "????"
+    };
+    return opcodeClass >= 0 && opcodeClass < CHIP8_OPCODE_CLASSES ? names[opcodeClass] : "????";
+}
+
+// Idle loops: roms often wait for the delay timer with FX07 / 3X00 / 1NNN or poll keys with EX9E / EXA1 in a short loop.
+// Nothing the loop can see changes inside one stepInstructions call (timers tick and keys change between calls), so once one
+// time round leaves the registers as they were, every time round after it will too, and the rest of the call can be skipped
+// in whole times round. The machine ends up in exactly the state running them would have left it in.
+#define IDLE_MAX_LOOP 8 //instructions including the jump, longer loops are doing real work
+
+static uint16_t opcodeAt(const chip8 *c8, uint16_t address) {
+    return (c8->mainMemory[address & 0xFFF] << 8) | c8->mainMemory[(address + 1) & 0xFFF];
+}
+
+static int idleSafe(uint16_t opcode) { //only reads and writes registers, so running it again on the same registers does the same thing
+    switch (opcode >> 12) {
+        case 0x3: case 0x4: case 0x6: case 0x7: case 0xA: return 1;
+        case 0x5: return (opcode & 0x000F) == 0 || (opcode & 0x000F) == 3; //5XY3 reads memory, idle loops don't write it
+        case 0x9: return (opcode & 0x000F) == 0;
+        case 0x8: return (opcode & 0x000F) <= 7 || (opcode & 0x000F) == 0xE;
+        case 0xE: return (opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1;
+        case 0xF: return (opcode & 0x00FF) == 0x07 || (opcode & 0x00FF) == 0x1E;
+        default: return 0; //memory, display, stack, timers, random numbers, other jumps
+    }
+}
+
+static int idleCandidate(const chip8 *c8, uint16_t address, uint16_t target) { //1NNN at address jumps back to target, is it worth checking for idling
+    if (target > address || address - target > 2 * (IDLE_MAX_LOOP - 1) || (target & 1)) return 0;
+    if (target == address) return 1; //jump to itself, end of a lot of roms
+    int polls = 0;
+    for (uint16_t a = target; a < address; a += 2) {
+        uint16_t opcode = opcodeAt(c8, a);
+        if (!idleSafe(opcode)) return 0;
+        if ((opcode & 0xF0FF) == 0xF007 || (opcode >> 12) == 0xE) polls = 1;
+    }
+    return polls; //anything else finishes on its own without waiting for a tick or key
+}
+
+// Breakpoints, see chip8.h. Address and opcode class breaks are BREAKS_MARKED: predecode gives the instructions they're on the
+// H_BREAK handler, which stops the interpreter before running them, so every other instruction runs exactly as it would without
+// a debugger. Idle loops aren't fast forwarded while they're set, that would run straight past one. Register breaks and watchpoints
+// are BREAKS_CHECKED: they need every instruction looked at, so stepInstructions swaps the interpreter for stepChecked while any are set.
+#define BREAKS_MARKED 1
+#define BREAKS_CHECKED 2
+_Static_assert(CHIP8_OPCODE_CLASSES <= 64, "opcodeClasses in breakpoints has a bit per class");
+
+static int breakAt(const chip8 *c8, uint16_t address, int handler) { //address or opcode class break on the instruction at address
+    address &= 0xFFF;
+    return ((c8->breaks.address[address >> 3] >> (address & 7)) & 1) || ((c8->breaks.opcodeClasses >> handler) & 1);
+}
+
+static void stopAt(chip8 *c8, int reason, int before, uint16_t address, int index, int unrun) { //before: the instruction at PC hasn't run yet
+    breakpoints *b = &c8->breaks;
+    b->stopReason = reason;
+    b->stoppedBefore = before;
+    b->stopPC = c8->regs.PC;
+    b->stopAddress = address;
+    b->stopIndex = index;
+    b->unrun = unrun;
+}
+
+static void stopBefore(chip8 *c8, uint16_t pc, int handler, int unrun) { //address or opcode class break, PC is back on the instruction
+    int onAddress = (c8->breaks.address[(pc & 0xFFF) >> 3] >> (pc & 7)) & 1;
+    stopAt(c8, onAddress ? CHIP8_STOP_PC : CHIP8_STOP_OPCODE, 1, pc, onAddress ? 0 : handler, unrun);
+}
+
+static int takeStop(chip8 *c8) { //forget the last stop, returns 1 if it was before the instruction at PC so that one runs rather than stopping again
+    breakpoints *b = &c8->breaks;
+    int resuming = b->stopReason && b->stoppedBefore && c8->regs.PC == b->stopPC; //not if something moved PC since (a step, a state loaded)
+    b->stopReason = CHIP8_STOP_NONE;
+    b->unrun = 0;
+    return resuming;
+}
+
+static int registerTrue(const chip8 *c8, const registerBreak *r) {
+    uint16_t value = r->reg < 16 ? c8->regs.V[r->reg] : c8->regs.I;
+    switch (r->test) {
+        case CHIP8_TEST_EQUAL: return value == r->value;
+        case CHIP8_TEST_NOT_EQUAL: return value != r->value;
+        case CHIP8_TEST_LESS: return value < r->value;
+        default: return value > r->value;
+    }
+}
+
+static int watchedWrite(const chip8 *c8, uint16_t opcode, uint16_t *written) { //watchpoint the instruction about to run would write to, -1 if none
+    int X = (opcode & 0x0F00) >> 8, Y = (opcode & 0x00F0) >> 4;
+    int length;
+    switch (handlerFor(opcode)) { //every instruction that writes memory, all of them write from I up
+        case H_FX33: length = 3; break;
+        case H_FX55: length = X + 1; break;
+        case H_5XY2: length = (X <= Y ? Y - X : X - Y) + 1; break;
+        default: return -1;
+    }
+    for (int i = 0; i < length; i++) {
+        uint16_t address = (c8->regs.I + i) & 0xFFF;
+        for (int w = 0; w < c8->breaks.watchCount; w++) {
+            if (address >= c8->breaks.watches[w].start && address <= c8->breaks.watches[w].end) {
+                *written = address;
+                return w;
+            }
+        }
+    }
+    return -1;
+}
+
+static void stepChecked(chip8 *c8, int count, int resuming) { //stepInstructions while register breaks or watchpoints are set, one instruction at a time
+    breakpoints *b = &c8->breaks;
+    while (count > 0) {
+        if (c8->keyWait) { //FX0A, same as the interpreter
+            c8->idleSkipped += count;
+            c8->idle = 1;
+            return;
+        }
+        uint16_t pc = c8->regs.PC;
+        uint16_t opcode = opcodeAt(c8, pc);
+        int handler = handlerFor(opcode);
+        if (!resuming) {
+            if (breakAt(c8, pc, handler)) {
+                stopBefore(c8, pc, handler, count);
+                return;
+            }
+            for (int i = 0; i < b->registerCount; i++) {
+                if (b->registers[i].address == (pc & 0xFFF) && registerTrue(c8, &b->registers[i])) {
+                    stopAt(c8, CHIP8_STOP_REGISTER, 1, pc, i, count);
+                    return;
+                }
+            }
+            uint16_t written = 0;
+            int watch = b->watchCount ? watchedWrite(c8, opcode, &written) : -1;
+            if (watch >= 0) { //stop with the write not done yet, resuming runs it
+                stopAt(c8, CHIP8_STOP_WATCH, 1, written, watch, count);
+                return;
+            }
+        }
+        resuming = 0;
+        fetchDecodeExecute(c8);
+        count--;
+        int hit = -1;
+        for (int i = 0; i < b->registerCount; i++) { //CHIP8_ANY_ADDRESS ones stop when they become true, not for as long as they stay true
+            if (b->registers[i].address != CHIP8_ANY_ADDRESS) continue;
+            uint16_t bit = 1 << i;
+            int now = registerTrue(c8, &b->registers[i]);
+            if (now && !(b->registerWas & bit) && hit < 0) hit = i;
+            b->registerWas = now ? b->registerWas | bit : b->registerWas & ~bit;
+        }
+        if (hit >= 0) {
+            stopAt(c8, CHIP8_STOP_REGISTER, 0, pc, hit, count);
+            return;
+        }
+    }
+}
+
+static void armBreaks(chip8 *c8) { //work out which kinds are set after a change
+    breakpoints *b = &c8->breaks;
+    b->armed = (b->addressCount > 0 || b->opcodeClasses != 0 ? BREAKS_MARKED : 0) | (b->registerCount > 0 || b->watchCount > 0 ? BREAKS_CHECKED : 0);
+    if (!b->armed) {
+        b->stopReason = CHIP8_STOP_NONE;
+        b->stoppedBefore = 0;
+        b->unrun = 0;
+    }
+}
+
+void setBreakpoint(chip8 *c8, uint16_t address, int on) {
+    breakpoints *b = &c8->breaks;
+    address &= 0xFFF;
+    uint8_t bit = 1 << (address & 7);
+    if (!(b->address[address >> 3] & bit) == !on) return; //already that way
+    b->address[address >> 3] ^= bit;
+    b->addressCount += on ? 1 : -1;
+    armBreaks(c8);
+    flushDecodedCache(c8); //marks go on or come off as instructions are decoded again, and idle loops are found again or not
+}
+
+void setOpcodeBreak(chip8 *c8, int opcodeClass, int on) {
+    if (opcodeClass < 1 || opcodeClass >= CHIP8_OPCODE_CLASSES) return;
+    uint64_t bit = (uint64_t)1 << opcodeClass;
+    c8->breaks.opcodeClasses = on ? c8->breaks.opcodeClasses | bit : c8->breaks.opcodeClasses & ~bit;
+    armBreaks(c8);
+    flushDecodedCache(c8);
+}
+
+int addRegisterBreak(chip8 *c8, uint16_t address, int reg, int test, uint16_t value) {
+    breakpoints *b = &c8->breaks;
+    if (b->registerCount == CHIP8_MAX_REGISTER_BREAKS || reg < 0 || reg > 16) return -1;
+    registerBreak *r = &b->registers[b->registerCount];
+    r->address = address == CHIP8_ANY_ADDRESS ? address : address & 0xFFF;
+    r->reg = reg;
+    r->test = test;
+    r->value = value;
+    if (r->address == CHIP8_ANY_ADDRESS && registerTrue(c8, r)) { //already true, wait for it to become true again
+        b->registerWas |= 1 << b->registerCount;
+    } else {
+        b->registerWas &= ~(1 << b->registerCount);
+    }
+    b->registerCount++;
+    armBreaks(c8);
+    return 0;
+}
+
+int addWatchpoint(chip8 *c8, uint16_t start, uint16_t end) {
+    breakpoints *b = &c8->breaks;
+    if (b->watchCount == CHIP8_MAX_WATCHPOINTS) return -1;
+    b->watches[b->watchCount].start = (start < end ? start : end) & 0xFFF;
+    b->watches[b->watchCount].end = (start < end ? end : start) & 0xFFF;
+    b->watchCount++;
+    armBreaks(c8);
+    return 0;
+}
+
+void clearBreakpoints(chip8 *c8) {
+    int marked = c8->breaks.armed & BREAKS_MARKED;
+    memset(&c8->breaks, 0, sizeof(c8->breaks));
+    if (marked) flushDecodedCache(c8); //take the H_BREAK marks off and let idle loops be found again
+}
+
+static void decodeFields(decodedInstruction *d, uint16_t opcode) {
+    d->opcode = opcode;
+    d->NNN = opcode & 0x0FFF;
+    d->NN = opcode & 0x00FF;
+    d->X = (opcode & 0x0F00) >> 8;
+    d->Y = (opcode & 0x00F0) >> 4;
+    d->handler = handlerFor(opcode);
+}
+
+static void predecode(chip8 *c8, decodedInstruction *d, uint16_t address) { //fill cache entry for instruction at even address
+    decodeFields(d, (c8->mainMemory[address] << 8) | c8->mainMemory[address + 1]);
+    if ((c8->breaks.armed & BREAKS_MARKED) && breakAt(c8, address, d->handler)) d->handler = H_BREAK; //the interpreter stops when it gets here
+    else if (d->handler == H_1NNN && !c8->breaks.armed && idleCandidate(c8, address, d->NNN)) d->handler = H_IDLE_LOOP;
+}
+
+int idleLoopAt(const chip8 *c8, uint16_t address) {
+    address &= 0xFFE;
+    uint16_t opcode = opcodeAt(c8, address);
+    return (opcode >> 12) == 0x1 && idleCandidate(c8, address, opcode & 0x0FFF);
+}
+
+void markIdleLoops(chip8 *c8, const uint16_t *loops, int count) {
+    if (c8->breaks.armed) return; //predecode doesn't make idle loops while breaks are set either
+    for (int i = 0; i < count; i++) {
+        uint16_t address = loops[i] & 0xFFE;
+        uint16_t opcode = opcodeAt(c8, address);
+        uint16_t target = opcode & 0x0FFF;
+        //only the shape is checked, not the loop body: fastForwardLoop checks every instruction it runs anyway, so a stale or
+        //hand edited address just never skips anything
+        if ((opcode >> 12) != 0x1 || target > address || address - target > 2 * (IDLE_MAX_LOOP - 1) || (target & 1)) continue;
+        decodedInstruction *d = &c8->decoded[address >> 1];
+        decodeFields(d, opcode);
+        d->handler = H_IDLE_LOOP;
+    }
+}
+
+void warmDecodedCache(chip8 *c8, uint16_t start, uint16_t end) {
+    for (int address = start & 0xFFE; address <= end && address < CHIP8_MEMORY_SIZE; address += 2) {
+        decodedInstruction *d = &c8->decoded[address >> 1];
+        if (d->handler == H_UNDECODED) predecode(c8, d, address);
+    }
+}
+
+static int fastForwardLoop(chip8 *c8, uint16_t jump, int count) { //loop closed by the jump at jump was just taken, returns how many of count instructions are left to run
+    uint16_t start = c8->regs.PC;
+    int steps = 0;
+    for (int tries = 0; tries < 2; tries++) { //first time round can still be picking up a new DT or key, the second has to match
+        uint8_t V[16];
+        uint16_t I = c8->regs.I;
+        memcpy(V, c8->regs.V, 16);
+        int before = steps;
+
+        //run one time round for real, stopping if it leaves the loop or something in it isn't safe any more (memory may have changed since predecode)
+        while (c8->regs.PC != jump) {
+            uint16_t pc = c8->regs.PC;
+            if (pc < start || pc > jump || steps == count) return count - steps; //left the loop, check again next time round
+            if (!idleSafe(opcodeAt(c8, pc))) { //loop was changed since predecode
+                c8->idleMiss = jump;
+                return count - steps;
+            }
+            fetchDecodeExecute(c8);
+            steps++;
+        }
+        if (memcmp(V, c8->regs.V, 16) == 0 && I == c8->regs.I) {
+            //back at the jump with nothing changed, every time round will be the same until the next tick or key press
+            //skip whole times round so the machine ends up exactly where running them would have left it
+            int left = count - steps;
+            int length = steps - before + 1; //the jump too
+            int skipped = left - left % length;
+            c8->idleSkipped += skipped;
+            if (skipped) c8->idle = 1;
+            return left - skipped;
+        }
+        if (steps == count) return 0;
+        fetchDecodeExecute(c8); //the jump, round again
+        steps++;
+    }
+    c8->idleMiss = jump; //still changing something, not waiting
+    return count - steps;
+}
+
+// Threaded dispatch over the predecoded cache, each handler jumps straight to the next one instead of going back through a loop and switch
+// uses computed goto on gcc/clang, plain switch otherwise
+#if defined(__GNUC__)
+#define HANDLER(h) L_##h:
+#define DISPATCH() goto *dispatchTable[d->handler]
+#else
+#define HANDLER(h) case h:
+#define DISPATCH() goto dispatch
+#endif
+
+#define NEXT() \
+    do { \
+        if (--count <= 0) return; \
+        goto next; \
+    } while (0)
+
+// stepInstructions is built once for each combination of quirks, each one has its quirks as constants so the checks are compiled out,
+// the variant number is a bit per quirk: 1 loadStoreRegQuirk, 2 spriteWrapClipQuirk, 4 bitShiftQuirk
+// a new quirk is one more bit and doubles the list, it costs nothing per instruction
+#define INTERPRETER_NAME stepQuirks0
+#define QUIRK_LOAD_STORE 0
+#define QUIRK_CLIP 0
+#define QUIRK_SHIFT 0
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks1
+#define QUIRK_LOAD_STORE 1
+#define QUIRK_CLIP 0
+#define QUIRK_SHIFT 0
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks2
+#define QUIRK_LOAD_STORE 0
+#define QUIRK_CLIP 1
+#define QUIRK_SHIFT 0
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks3
+#define QUIRK_LOAD_STORE 1
+#define QUIRK_CLIP 1
+#define QUIRK_SHIFT 0
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks4
+#define QUIRK_LOAD_STORE 0
+#define QUIRK_CLIP 0
+#define QUIRK_SHIFT 1
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks5
+#define QUIRK_LOAD_STORE 1
+#define QUIRK_CLIP 0
+#define QUIRK_SHIFT 1
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks6
+#define QUIRK_LOAD_STORE 0
+#define QUIRK_CLIP 1
+#define QUIRK_SHIFT 1
+#include "interpreter.h"
+#define INTERPRETER_NAME stepQuirks7
+#define QUIRK_LOAD_STORE 1
+#define QUIRK_CLIP 1
+#define QUIRK_SHIFT 1
+#include "interpreter.h"
+
+#define QUIRK_VARIANTS 8
+
+static void (*const interpreters[QUIRK_VARIANTS])(chip8 *c8, int count) = {
+    stepQuirks0, stepQuirks1, stepQuirks2, stepQuirks3, stepQuirks4, stepQuirks5, stepQuirks6, stepQuirks7
+};
+
+void selectInterpreter(chip8 *c8) {
+    c8->interpreter = (c8->loadStoreRegQuirk != 0) | (c8->spriteWrapClipQuirk != 0) << 1 | (c8->bitShiftQuirk != 0) << 2;
+}
+
+void stepInstructions(chip8 *c8, int count) {
+    c8->idle = 0;
+    c8->idleMiss = 0xFFFF; //every loop gets checked again, the timers or keys may have changed
+    int resuming = c8->breaks.armed ? takeStop(c8) : 0;
+    if (count <= 0) return;
+    if (c8->keyWait) { //stopped on FX0A, nothing runs until a key is pressed and released
+        c8->idleSkipped += count;
+        c8->idle = 1;
+        return;
+    }
+    if (c8->breaks.armed) { //debugging, marked breaks alone still run on the interpreter
+        if ((c8->breaks.armed & BREAKS_CHECKED) || instrumented(c8)) {
+            stepChecked(c8, count, resuming);
+            return;
+        }
+        if (resuming) { //it stopped before this instruction last time, run it rather than its H_BREAK
+            fetchDecodeExecute(c8);
+            if (--count == 0) return;
+            if (c8->keyWait) {
+                c8->idleSkipped += count;
+                c8->idle = 1;
+                return;
+            }
+        }
+    }
+    if (instrumented(c8)) { //traced or profiled machines go one instruction at a time through fetchDecodeExecute so every one is seen
+        while (count-- > 0) fetchDecodeExecute(c8);
+        return;
+    }
+    interpreters[c8->interpreter](c8, count); //chosen when the rom was loaded or a quirk last changed
+}
+
+#undef HANDLER
+#undef DISPATCH
+#undef NEXT
+
+int tickTimers(chip8 *c8) { //returns 1 if sound timer was running this tick so frontend can play sound
+    int soundOn = 0;
+    if (c8->regs.DT > 0) c8->regs.DT--; //decrement delay timer by 1
+    if (c8->regs.ST > 0) {
+        c8->regs.ST--; // decrement sound timer by 1
+        soundOn = 1;
+    }
+    return soundOn;
+}
+
+int getPixel(const chip8 *c8, int x, int y) {
+    int colour = 0;
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        colour |= ((c8->display[plane][y][x >> 6] >> (63 - (x & 63))) & 1) << plane;
+    }
+    return colour;
+}
+
+int displayWidth(const chip8 *c8) {
+    return c8->hires ? CHIP8_HIRES_WIDTH : CHIP8_DISPLAY_WIDTH;
+}
+
+int displayHeight(const chip8 *c8) {
+    return c8->hires ? CHIP8_HIRES_HEIGHT : CHIP8_DISPLAY_HEIGHT;
+}
@@ -0,0 +1,145 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stdint.h> //for unsignted ints
+#include <stddef.h> //for size_t
+
+// Chip8 core, everything a single machine needs lives in the chip8 struct so any number of machines can run in one process
+// core doesn't depend on SDL, frontends (SDL window, headless runners etc) drive it through the functions below
+
+#define CHIP8_MEMORY_SIZE 4096
+#define CHIP8_ROM_START 0x200 // roms are loaded and start executing here
+#define CHIP8_MAX_ROM_SIZE (CHIP8_MEMORY_SIZE - CHIP8_ROM_START)
+#define CHIP8_DISPLAY_WIDTH 64 // lores, the original display
+#define CHIP8_DISPLAY_HEIGHT 32
+#define CHIP8_HIRES_WIDTH 128 // SCHIP/XO-CHIP hires, 00FF switches to it and 00FE back
+#define CHIP8_HIRES_HEIGHT 64
+#define CHIP8_PLANES 2 // XO-CHIP bitplanes, FN01 picks which ones draw, scroll and clear
+#define CHIP8_ROW_WORDS 2 // 64 bit words per display row, lores only uses the first
+#define CHIP8_BIG_FONT 0x50 // FX30 10 byte hex digits, right after the 5 byte ones
+#define CHIP8_OPCODE_CLASSES 51 // kinds of instruction opcodeClass can return, including unknown
+#define CHIP8_KEY_WAIT_PRESS 1 // keyWait while FX0A waits for a key to go down
+#define CHIP8_KEY_WAIT_RELEASE 2 // and then for that key to come back up
+#define CHIP8_DEFAULT_SEED 0x2545F491 // rngState after initialiseSystem, so runs are repeatable unless seedRandom picks another
+#define CHIP8_MAX_REGISTER_BREAKS 8
+#define CHIP8_MAX_WATCHPOINTS 8
+#define CHIP8_STOP_NONE 0 // breaks.stopReason, why the last stepInstructions stopped early
+#define CHIP8_STOP_PC 1 // reached a breakpoint address
+#define CHIP8_STOP_OPCODE 2 // reached an instruction of a class setOpcodeBreak armed
+#define CHIP8_STOP_REGISTER 3 // a register break's condition came true
+#define CHIP8_STOP_WATCH 4 // an instruction wrote to a watched address
+#define CHIP8_TEST_EQUAL 0 // registerBreak tests
+#define CHIP8_TEST_NOT_EQUAL 1
+#define CHIP8_TEST_LESS 2
+#define CHIP8_TEST_GREATER 3
+#define CHIP8_ANY_ADDRESS 0xFFFF // registerBreak checked after every instruction rather than before one address
+
+typedef struct {
+    uint8_t V[16]; // 16 registers (V0 to VF (0-15), VF is flag register)
+    uint16_t I; // Index register
+    uint8_t DT; // Delay timer
+    uint8_t ST; // Sound timer
+    uint16_t PC; // Program counter holds address of next instruction in memory unless modified by opcode
+    uint8_t SP; // Stack pointer
+} registers;
+
+typedef struct {
+    uint16_t address; // check before the instruction here runs, or CHIP8_ANY_ADDRESS to stop when the condition becomes true after any instruction
+    uint8_t reg; // 0-15 for V0-VF, 16 for I
+    uint8_t test; // CHIP8_TEST_*
+    uint16_t value;
+} registerBreak;
+
+typedef struct {
+    uint16_t start, end; // inclusive
+} watchpoint;
+
+// Debugger breakpoints. Nothing is checked while none are armed. Address and opcode class breaks are marks put on the predecoded
+// instructions so the interpreter only notices them when it reaches one, register breaks and watchpoints need every instruction
+// looked at so stepInstructions runs one at a time while any are set. Not part of saved state, initialiseSystem leaves them alone.
+typedef struct {
+    uint8_t address[CHIP8_MEMORY_SIZE / 8]; // bit per address
+    uint64_t opcodeClasses; // bit per opcodeClass
+    int addressCount;
+    registerBreak registers[CHIP8_MAX_REGISTER_BREAKS];
+    int registerCount;
+    uint16_t registerWas; // bit per CHIP8_ANY_ADDRESS break, its condition was true after the last instruction
+    watchpoint watches[CHIP8_MAX_WATCHPOINTS];
+    int watchCount;
+    uint8_t armed; // what kinds are set, 0 for none
+    uint8_t stopReason; // CHIP8_STOP_*, kept until the next stepInstructions
+    uint8_t stoppedBefore; // 1 if the instruction at stopPC hasn't run yet (PC, opcode, watchpoint and at-address register stops), it runs next time rather than stopping again
+    uint16_t stopPC; // PC when it stopped
+    uint16_t stopAddress; // address about to be written for a watchpoint stop, otherwise the instruction the break is on
+    int stopIndex; // which register break or watchpoint, the opcodeClass for an opcode stop
+    int unrun; // instructions of the last stepInstructions count that didn't run because it stopped
+} breakpoints;
+
+// predecoded instruction, one per even address so the hot loop doesn't redo the fetch/decode work every time
+typedef struct {
+    uint8_t handler; // which op to run, 0 means not decoded yet
+    uint8_t X;
+    uint8_t Y;
+    uint8_t NN; // N is the low 4 bits of NN
+    uint16_t NNN;
+    uint16_t opcode; // whole instruction, for lastInstruction
+} decodedInstruction;
+
+typedef struct {
+    // https://github.com/mattmikolay/chip-8/wiki/CHIP%E2%80%908-Instruction-Set#notes, followed for Original behaviour, quirks are based on behaviour from other sources such as CowGod technical reference for chip8
+    int loadStoreRegQuirk; //flag for register I should be incremented by X + 1 (if 0) or not incremented at all (if non 0)
+    int spriteWrapClipQuirk; //flag for if partially drawn sprites wrap around (if 0) or get clipped (non 0), sprites drawn completely
+    int bitShiftQuirk; //flag for if 8XY6 and 8XYE should use register  VX and VY (0) or VX only (non 0)
+
+    uint8_t mainMemory[CHIP8_MEMORY_SIZE]; // Main 4096 bytes of memory, each instruction is 2 bytes (16 bits, 2 addresses)
+    uint16_t stack[16]; // Stack stores up to 16 return address
+    uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS]; // each plane is a row of 64 bit words, leftmost pixel is the top bit of the first word, lores is 32 rows of 1 word
+    uint8_t hires; // 1 for 128x64, 0 for 64x32
+    uint8_t planes; // bit per plane DXYN, 00E0 and the scrolls work on, 1 (just the first) unless FN01 changes it
+    uint8_t flags[16]; // SCHIP RPL flags for FX75/FX85
+    uint32_t displayGeneration; // goes up whenever the display may have changed (draw, clear, scroll, mode switch, state loaded), not part of saved state, a frontend compares it to skip redrawing a still screen
+    uint8_t keys[16]; // Keypad with 16 keys (0x0 to 0xF)
+    uint8_t keyWait; // 0 when running, CHIP8_KEY_WAIT_PRESS or CHIP8_KEY_WAIT_RELEASE while stopped on FX0A
+    uint8_t keyWaitRegister; // X of the FX0A waiting
+    uint8_t keyWaitKey; // key that went down, goes in VX when it's released
+    uint16_t keyWaitHeld; // keys that were already down when FX0A started, bit per key, they have to be let go first
+    registers regs;
+
+    uint16_t lastInstruction; //for tracking last instruction
+    uint32_t rngState; //CXNN random number generator, never 0
+    uint8_t interpreter; //which quirk specialised version of stepInstructions runs, set from the quirk flags by selectInterpreter
+    uint8_t idle; //last stepInstructions ended waiting on the delay timer or a key, nothing will change until a timer tick or key press
+    uint16_t idleMiss; //loop that was still doing something when checked, not checked again this stepInstructions
+    uint64_t idleSkipped; //instructions stepInstructions skipped through in idle loops and FX0A, counted as run
+    breakpoints breaks; //debugger, set with the functions below
+
+    decodedInstruction decoded[CHIP8_MEMORY_SIZE / 2]; // cache for each even address, filled on first execution, cleared when memory under it is written
+    struct chip8Jit *jit; // recompiler state from jit.c, NULL when only interpreting
+    struct chip8Trace *trace; // instruction trace from trace.c, NULL when not tracing, only looked at in -DCHIP8_TRACE builds
+    struct chip8Profile *profile; // guest profiler from profile.c, NULL when not profiling, only looked at in -DCHIP8_PROFILE builds
+} chip8;
+
+void initialiseSystem(chip8 *c8); //set all default values and sprites, quirk flags are left as they are
+void selectInterpreter(chip8 *c8); //quirk flags were changed, call before the next stepInstructions (initialiseSystem, loadROMBuffer and loadState do it for you)
+int loadROMBuffer(chip8 *c8, const uint8_t *rom, size_t size); //copy rom into memory at 0x200, returns 0 on success, -1 if too large
+void fetchDecodeExecute(chip8 *c8); //run one instruction
+void stepInstructions(chip8 *c8, int count); //run count instructions back to back using the predecoded cache, same result as calling fetchDecodeExecute count times
+int tickTimers(chip8 *c8); //one 60hz tick of delay and sound timer, returns 1 if sound timer was running
+void seedRandom(chip8 *c8, uint32_t seed); //start CXNN's random numbers from seed, call after initialiseSystem, 0 means CHIP8_DEFAULT_SEED
+void setKey(chip8 *c8, int key, int pressed); //key went down (1) or up (0), use this rather than writing keys so FX0A sees every press even between calls
+int getPixel(const chip8 *c8, int x, int y); //colour of pixel at x,y, bit per plane so 0 is off and 1 is on for anything not using FN01
+int displayWidth(const chip8 *c8); //64 or 128 depending on hires
+int displayHeight(const chip8 *c8); //32 or 64
+int opcodeClass(uint16_t opcode); //which kind of instruction (00E0, 8XY4, DXYN etc), 1 to CHIP8_OPCODE_CLASSES - 1, same numbering the predecoded cache uses
+const char *opcodeClassName(int opcodeClass); //e.g. "DXYN"
+void flushDecodedCache(chip8 *c8); //all of memory may have changed (e.g. a snapshot was loaded), drop every predecoded instruction
+void warmDecodedCache(chip8 *c8, uint16_t start, uint16_t end); //predecode the instructions from start to end now rather than on first run, e.g. code a rom database says is reachable
+int idleLoopAt(const chip8 *c8, uint16_t address); //1 if address holds a 1NNN closing a loop stepInstructions can fast forward through (timer or key polling, jump to itself)
+void markIdleLoops(chip8 *c8, const uint16_t *loops, int count); //predecode the 1NNNs at loops as idle loops without looking through them again, e.g. ones a rom database found earlier
+void setBreakpoint(chip8 *c8, uint16_t address, int on); //stop stepInstructions before the instruction at address runs
+void setOpcodeBreak(chip8 *c8, int opcodeClass, int on); //stop before any instruction of that class runs
+int addRegisterBreak(chip8 *c8, uint16_t address, int reg, int test, uint16_t value); //returns 0 on success, -1 if they're all used
+int addWatchpoint(chip8 *c8, uint16_t start, uint16_t end); //stop before an instruction (FX33, FX55, 5XY2) writes anywhere from start to end, returns 0 on success, -1 if they're all used
+void clearBreakpoints(chip8 *c8); //remove every break and watchpoint, stepInstructions is back to full speed
+
+#endif
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h> //socket thread waits on the listening socket and every client at once
+#include <sys/socket.h>
+#include <sys/stat.h> //to check an old socket file really is a socket before removing it
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "control.h"
+
+static void queueLine(controlChannel *cc, spscQueue *q, const char *text) { //reader threads, waits for space rather than dropping a command
+    char line[CONTROL_LINE];
+    snprintf(line, sizeof(line), "%s", text);
+    while (spscPush(q, line) != 0) {
+        if (!atomic_load(&cc->running)) return;
+        SDL_Delay(1);
+    }
+    if (cc->wakeEvent != (Uint32)-1) {
+        SDL_Event wake = { .type = cc->wakeEvent };
+        SDL_PushEvent(&wake); //thread safe, gets a sleeping SDL thread to drain the queue
+    }
+}
+
+static int consoleThread(void *data) {
+    controlChannel *cc = data;
+    char line[CONTROL_LINE];
+    while (fgets(line, sizeof(line), stdin)) { //blocks until a line is typed, returns NULL at end of input
+        line[strcspn(line, "\r\n")] = '\0';
+        queueLine(cc, &cc->console, line);
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+typedef struct {
+    int fd; //-1 if the slot is free
+    int length; //bytes of a line read so far
+    char buffer[CONTROL_LINE];
+} controlClient;
+
+static int readClient(controlChannel *cc, controlClient *client) { //returns -1 once the client has gone
+    ssize_t n = read(client->fd, client->buffer + client->length, CONTROL_LINE - 1 - client->length);
+    if (n <= 0) {
+        return -1;
+    }
+    client->length += (int)n;
+    int start = 0;
+    for (int i = 0; i < client->length; i++) { //hand over every complete line
+        if (client->buffer[i] == '\n') {
+            client->buffer[i] = '\0';
+            if (i > start && client->buffer[i - 1] == '\r') client->buffer[i - 1] = '\0';
+            queueLine(cc, &cc->socket, client->buffer + start);
+            start = i + 1;
+        }
+    }
+    if (start == 0 && client->length == CONTROL_LINE - 1) { //no newline in a whole buffer, split it like fgets would
+        client->buffer[client->length] = '\0';
+        queueLine(cc, &cc->socket, client->buffer);
+        start = client->length;
+    }
+    memmove(client->buffer, client->buffer + start, client->length - start); //keep the partial line for next time
+    client->length -= start;
+    return 0;
+}
+
+static int socketThread(void *data) {
+    controlChannel *cc = data;
+    controlClient clients[CONTROL_MAX_CLIENTS];
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) clients[i].fd = -1;
+    struct pollfd fds[1 + CONTROL_MAX_CLIENTS];
+    int slot[1 + CONTROL_MAX_CLIENTS]; //which client each pollfd is
+    while (atomic_load(&cc->running)) {
+        int count = 0;
+        fds[count++] = (struct pollfd){ cc->listenFd, POLLIN, 0 };
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            if (clients[i].fd < 0) continue;
+            slot[count] = i;
+            fds[count++] = (struct pollfd){ clients[i].fd, POLLIN, 0 };
+        }
+        if (poll(fds, count, 100) <= 0) continue; //wakes up every 100ms to see if controlStop was called
+        for (int f = 1; f < count; f++) {
+            controlClient *client = &clients[slot[f]];
+            if ((fds[f].revents & (POLLIN | POLLHUP | POLLERR)) && readClient(cc, client) != 0) {
+                close(client->fd);
+                client->fd = -1;
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(cc->listenFd, NULL, NULL);
+            if (fd < 0) continue;
+            int i = 0;
+            while (i < CONTROL_MAX_CLIENTS && clients[i].fd >= 0) i++;
+            if (i == CONTROL_MAX_CLIENTS) {
+                close(fd); //too many, they can try again
+                continue;
+            }
+            clients[i].fd = fd;
+            clients[i].length = 0;
+        }
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) close(clients[i].fd);
+    }
+    return 0;
+}
+
+static int openSocket(controlChannel *cc, const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("Control socket path is too long: %s\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    struct stat info;
+    if (lstat(path, &info) == 0) { //left behind by a run that didn't exit cleanly, only remove it if it's a socket
+        if (!S_ISSOCK(info.st_mode)) {
+            printf("%s exists and isn't a socket, not replacing it\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("Failed to create control socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, CONTROL_MAX_CLIENTS) != 0) {
+        printf("Failed to listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    cc->listenFd = fd;
+    strcpy(cc->socketPath, path);
+    return 0;
+}
+#endif
+
+int controlStart(controlChannel *cc, const char *socketPath, Uint32 wakeEvent) {
+    spscInit(&cc->console, cc->consoleLines, CONTROL_QUEUE_SIZE, CONTROL_LINE);
+    spscInit(&cc->socket, cc->socketLines, CONTROL_QUEUE_SIZE, CONTROL_LINE);
+    cc->wakeEvent = wakeEvent;
+    cc->socketThread = NULL;
+    cc->listenFd = -1;
+    cc->socketPath[0] = '\0';
+    atomic_init(&cc->running, 1);
+    SDL_Thread *console = SDL_CreateThread(consoleThread, "console", cc);
+    if (console) {
+        SDL_DetachThread(console); //ends with the process, fgets can't be interrupted
+    } else {
+        printf("Failed to create console thread: %s\n", SDL_GetError());
+    }
+    if (socketPath == NULL) {
+        return 0;
+    }
+#ifdef _WIN32
+    printf("Control sockets aren't supported on Windows, use the console\n");
+    return -1;
+#else
+    if (openSocket(cc, socketPath) != 0) {
+        return -1;
+    }
+    cc->socketThread = SDL_CreateThread(socketThread, "control", cc);
+    if (!cc->socketThread) {
+        printf("Failed to create control thread: %s\n", SDL_GetError());
+        close(cc->listenFd);
+        unlink(cc->socketPath);
+        cc->listenFd = -1;
+        return -1;
+    }
+    printf("Listening for commands on %s\n", socketPath);
+    return 0;
+#endif
+}
+
+int controlPoll(controlChannel *cc, char *line) {
+    if (spscPop(&cc->console, line) == 0) return CONTROL_CONSOLE;
+    if (spscPop(&cc->socket, line) == 0) return CONTROL_SOCKET;
+    return 0;
+}
+
+void controlStop(controlChannel *cc) {
+    atomic_store(&cc->running, 0); //readers stop waiting for queue space, the socket thread leaves its loop
+    if (cc->socketThread) {
+        SDL_WaitThread(cc->socketThread, NULL);
+        cc->socketThread = NULL;
+    }
+#ifndef _WIN32
+    if (cc->listenFd >= 0) {
+        close(cc->listenFd);
+        unlink(cc->socketPath);
+        cc->listenFd = -1;
+    }
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef CHIP8_CONTROL_H
+#define CHIP8_CONTROL_H
+
+#include <stdatomic.h> //C11 atomics
+#include <SDL2/SDL.h>
+#include "lockfree.h"
+
+// Text command channel for the SDL frontend, one command per line from the console and, with --control, from a
+// local UNIX domain socket so scripts can drive a running emulator (echo "load Pong.ch8" | nc -U chip8.sock).
+// Each source has its own reader thread that blocks on input and hands whole lines over in its own spsc queue,
+// the SDL thread drains both every loop and is woken with an SDL event when a line arrives, so nothing ever
+// waits on the console and emulation keeps going while a prompt is unanswered.
+
+#define CONTROL_LINE 256 //longest line, longer ones are split
+#define CONTROL_QUEUE_SIZE 32 //lines waiting per source, power of two, a reader waits for space if the SDL thread is behind
+#define CONTROL_MAX_CLIENTS 8 //socket connections at once, more are closed straight away
+#define CONTROL_CONSOLE 1 //controlPoll source, stdin
+#define CONTROL_SOCKET 2 //controlPoll source, a socket client
+
+typedef struct {
+    spscQueue console; //stdin thread -> SDL thread
+    spscQueue socket; //socket thread -> SDL thread
+    char consoleLines[CONTROL_QUEUE_SIZE][CONTROL_LINE];
+    char socketLines[CONTROL_QUEUE_SIZE][CONTROL_LINE];
+    Uint32 wakeEvent; //SDL user event pushed with every line, (Uint32)-1 for none
+    SDL_Thread *socketThread; //NULL without --control, the console thread is detached since nothing can unblock fgets
+    int listenFd; //-1 without a socket
+    char socketPath[108]; //sun_path is 108 bytes on Linux
+    atomic_int running;
+} controlChannel;
+
+int controlStart(controlChannel *cc, const char *socketPath, Uint32 wakeEvent); //start reading stdin, and socketPath if not NULL, returns 0 on success, -1 if the socket couldn't be made (stdin still works)
+int controlPoll(controlChannel *cc, char *line); //SDL thread, copies the next line (CONTROL_LINE bytes) and returns CONTROL_CONSOLE or CONTROL_SOCKET, 0 if there isn't one
+void controlStop(controlChannel *cc); //close and remove the socket
+
+#endif
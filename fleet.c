@@ -0,0 +1,689 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h> //for unsignted ints
+#include <pthread.h> //worker threads
+#include <time.h> //for timing each job
+#include <dirent.h> //rom directories for regression runs
+#ifdef _WIN32
+#include <windows.h> //for core count
+#else
+#include <unistd.h> //for core count
+#endif
+#include "chip8.h" //emulator core, no SDL needed
+#ifdef CHIP8_JIT
+#include "jit.h" //optional recompiler, -j
+#endif
+#ifdef CHIP8_TRACE
+#include "trace.h" //optional instruction trace, -T
+#endif
+#ifdef CHIP8_PROFILE
+#include "profile.h" //optional guest profiler, -P
+#endif
+
+// Headless fleet runner, runs a list of rom jobs with no window and no frame delay across all cores
+// job file has one job per line: rom ipf frames quirks script
+//   rom    - rom filename
+//   ipf    - instructions per frame
+//   frames - how many 60hz frames to run (ipf instructions then one timer tick per frame)
+//   quirks - any of l (loadStoreRegQuirk), c (spriteWrapClipQuirk), s (bitShiftQuirk), or - for none
+//   script - optional file of key presses, one per line: frame key down|up (key in hex), pressed before that frame runs
+// lines starting with # are ignored
+// a directory instead of a job file runs every rom in it (.ch8 .c8 .sc8 .xo8) for -f frames (600) at -i ipf (10) with no quirks,
+// and a file next to a rom with the same name ending .keys is its script
+// -j runs jobs on the x86-64 recompiler when built with -DCHIP8_JIT jit.c
+// -T writes an instruction trace of each job to <outdir>/jobN.c8t when built with -DCHIP8_TRACE trace.c
+// -P profiles each job into <outdir>/jobN.profile.txt and <outdir>/jobN.folded when built with -DCHIP8_PROFILE profile.c
+// each job writes <outdir>/jobN.pbm (final display) and <outdir>/jobN.txt (registers, stack, instructions/sec)
+// regression runs hash the display and the registers, timers and stack every -c frames (60) and at the end:
+// -G golden.txt writes every job's checkpoints to golden.txt, -g golden.txt checks them against it and stops each job
+// at the first checkpoint that differs, writing its pbm and txt from there, exits 1 if any job didn't match
+
+#define REGRESS_NONE 0
+#define REGRESS_COMPARE 1 //-g
+#define REGRESS_UPDATE 2 //-G
+#define FNV_BASIS 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+typedef struct {
+    long frame;
+    uint8_t key;
+    uint8_t pressed;
+} scriptEvent;
+
+typedef struct {
+    long frame; //frames run when it was taken
+    uint64_t displayHash; //mode, plane select and every plane
+    uint64_t stateHash; //registers, timers and stack
+} checkpoint;
+
+typedef struct {
+    char job[600]; //jobKey of the job it belongs to
+    checkpoint check;
+} goldenEntry;
+
+typedef struct {
+    int id; //line order in job file, used for output file names
+    char rom[256];
+    int IPF;
+    long frames;
+    int loadStoreRegQuirk;
+    int spriteWrapClipQuirk;
+    int bitShiftQuirk;
+    char script[256]; //key presses, empty for none
+
+    //results filled in by worker
+    int failed;
+    long long instructions; //actually executed
+    long long skipped; //fast forwarded through in idle loops and FX0A waits, run as far as the machine can tell but never executed
+    double seconds;
+    checkpoint *checks; //regression runs only
+    int checkCount;
+    const char *mismatch; //-g, what differed at the last checkpoint, NULL if everything matched
+} fleetJob;
+
+// Work stealing: each worker has its own deque of jobs, takes from the bottom of its own
+// and when empty steals from the top of another workers deque, so long jobs don't leave cores idle
+typedef struct {
+    pthread_mutex_t lock;
+    fleetJob **jobs;
+    int top; //next job to steal
+    int bottom; //one past last job, owner pops from here
+} jobDeque;
+
+typedef struct {
+    int index;
+    int workerCount;
+    jobDeque *deques; //all workers deques, for stealing
+    const char *outDir;
+    int useJit;
+    int useTrace;
+    int useProfile;
+    int regressMode;
+    int checkInterval; //frames between checkpoints
+    const goldenEntry *golden; //-g, sorted by job then frame, shared read only by every worker
+    int goldenCount;
+    chip8 machine; //one machine per worker, reused for every job it runs
+} fleetWorker;
+
+static fleetJob *popBottom(jobDeque *d) {
+    fleetJob *job = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        job = d->jobs[--d->bottom];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+static fleetJob *stealTop(jobDeque *d) {
+    fleetJob *job = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        job = d->jobs[d->top++];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int readROMFile(const char *name, uint8_t *buffer, size_t *size) { //same as frontend loadROM but returns error instead of exiting
+    FILE *rom = fopen(name, "rb");
+    if (rom == NULL) {
+        return -1;
+    }
+    *size = fread(buffer, 1, CHIP8_MAX_ROM_SIZE + 1, rom); //one extra byte so too large roms can be detected
+    fclose(rom);
+    return 0;
+}
+
+static void jobKey(const fleetJob *job, char *key, size_t size) { //what golden entries are filed under, anything that changes the run is in it
+    char quirks[4];
+    int n = 0;
+    if (job->loadStoreRegQuirk) quirks[n++] = 'l';
+    if (job->spriteWrapClipQuirk) quirks[n++] = 'c';
+    if (job->bitShiftQuirk) quirks[n++] = 's';
+    if (n == 0) quirks[n++] = '-';
+    quirks[n] = '\0';
+    snprintf(key, size, "%s:%d:%ld:%s%s%s", job->rom, job->IPF, job->frames, quirks, job->script[0] ? ":" : "", job->script);
+}
+
+static uint64_t hashByte(uint64_t hash, uint8_t byte) { //64 bit FNV-1a
+    return (hash ^ byte) * FNV_PRIME;
+}
+
+static void takeCheckpoint(const chip8 *c8, long frame, checkpoint *check) { //hashes go byte by byte so they match across platforms
+    uint64_t hash = FNV_BASIS;
+    hash = hashByte(hash, c8->hires);
+    hash = hashByte(hash, c8->planes);
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        for (int y = 0; y < CHIP8_HIRES_HEIGHT; y++) {
+            for (int w = 0; w < CHIP8_ROW_WORDS; w++) {
+                for (int b = 0; b < 8; b++) {
+                    hash = hashByte(hash, (uint8_t)(c8->display[plane][y][w] >> (56 - 8 * b)));
+                }
+            }
+        }
+    }
+    check->displayHash = hash;
+    hash = FNV_BASIS;
+    for (int i = 0; i < 16; i++) {
+        hash = hashByte(hash, c8->regs.V[i]);
+    }
+    uint16_t words[2] = { c8->regs.I, c8->regs.PC };
+    for (int i = 0; i < 2; i++) {
+        hash = hashByte(hash, words[i] & 0xFF);
+        hash = hashByte(hash, words[i] >> 8);
+    }
+    hash = hashByte(hash, c8->regs.SP);
+    hash = hashByte(hash, c8->regs.DT);
+    hash = hashByte(hash, c8->regs.ST);
+    for (int i = 0; i < 16; i++) {
+        hash = hashByte(hash, c8->stack[i] & 0xFF);
+        hash = hashByte(hash, c8->stack[i] >> 8);
+    }
+    check->stateHash = hash;
+    check->frame = frame;
+}
+
+static int compareGolden(const void *a, const void *b) { //job then frame, for qsort and bsearch
+    const goldenEntry *x = a, *y = b;
+    int order = strcmp(x->job, y->job);
+    if (order != 0) return order;
+    return (x->check.frame > y->check.frame) - (x->check.frame < y->check.frame);
+}
+
+static const char *checkGolden(const fleetWorker *w, const char *key, const checkpoint *check) { //NULL if it matches, otherwise what didn't
+    goldenEntry want;
+    snprintf(want.job, sizeof(want.job), "%s", key);
+    want.check.frame = check->frame;
+    const goldenEntry *e = bsearch(&want, w->golden, w->goldenCount, sizeof(goldenEntry), compareGolden);
+    if (e == NULL) return "no golden checkpoint";
+    int display = e->check.displayHash != check->displayHash;
+    int state = e->check.stateHash != check->stateHash;
+    if (display && state) return "display and registers differ";
+    if (display) return "display differs";
+    if (state) return "registers differ";
+    return NULL;
+}
+
+static int readScript(const char *name, scriptEvent **eventsOut) { //returns how many events, -1 if the file can't be read or frames go backwards
+    FILE *f = fopen(name, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    int count = 0, capacity = 16;
+    scriptEvent *events = malloc(capacity * sizeof(scriptEvent));
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        long frame;
+        unsigned key;
+        char state[8];
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        if (sscanf(line, "%ld %x %7s", &frame, &key, state) != 3 || key > 0xF || (strcmp(state, "down") != 0 && strcmp(state, "up") != 0)
+            || frame < 0 || (count > 0 && frame < events[count - 1].frame)) {
+            free(events);
+            fclose(f);
+            return -1;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            events = realloc(events, capacity * sizeof(scriptEvent));
+        }
+        events[count].frame = frame;
+        events[count].key = key;
+        events[count].pressed = strcmp(state, "down") == 0;
+        count++;
+    }
+    fclose(f);
+    *eventsOut = events;
+    return count;
+}
+
+static void writeResults(fleetWorker *w, fleetJob *job) {
+    chip8 *c8 = &w->machine;
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/job%d.pbm", w->outDir, job->id);
+    FILE *pbm = fopen(path, "w");
+    if (pbm) { //plain pbm, 1 is a pixel lit in any plane, 128x64 in hires
+        fprintf(pbm, "P1\n%d %d\n", displayWidth(c8), displayHeight(c8));
+        for (int y = 0; y < displayHeight(c8); y++) {
+            for (int x = 0; x < displayWidth(c8); x++) {
+                fputc(getPixel(c8, x, y) ? '1' : '0', pbm);
+            }
+            fputc('\n', pbm);
+        }
+        fclose(pbm);
+    }
+
+    snprintf(path, sizeof(path), "%s/job%d.txt", w->outDir, job->id);
+    FILE *txt = fopen(path, "w");
+    if (txt) {
+        fprintf(txt, "rom: %s\nipf: %d\nframes: %ld\n", job->rom, job->IPF, job->frames);
+        if (job->mismatch) {
+            fprintf(txt, "failed at frame: %ld, %s\n", job->checks[job->checkCount - 1].frame, job->mismatch);
+        }
+        fprintf(txt, "instructions: %lld\nskipped: %lld\nseconds: %.6f\ninstructions/sec: %.0f\n", job->instructions, job->skipped, job->seconds, job->seconds > 0 ? job->instructions / job->seconds : 0.0);
+        for (int i = 0; i < 16; i++) {
+            fprintf(txt, "V%X: %02X\n", i, c8->regs.V[i]);
+        }
+        fprintf(txt, "I: %04X\nPC: %04X\nSP: %02X\nDT: %02X\nST: %02X\n", c8->regs.I, c8->regs.PC, c8->regs.SP, c8->regs.DT, c8->regs.ST);
+        for (int i = 0; i < 16; i++) {
+            fprintf(txt, "S%X: %04X\n", i, c8->stack[i]);
+        }
+        fclose(txt);
+    }
+}
+
+static void runJob(fleetWorker *w, fleetJob *job) {
+    chip8 *c8 = &w->machine;
+    uint8_t buffer[CHIP8_MAX_ROM_SIZE + 1];
+    size_t size;
+    scriptEvent *events = NULL;
+    int eventCount = 0;
+
+    c8->loadStoreRegQuirk = job->loadStoreRegQuirk;
+    c8->spriteWrapClipQuirk = job->spriteWrapClipQuirk;
+    c8->bitShiftQuirk = job->bitShiftQuirk;
+    initialiseSystem(c8);
+    if (readROMFile(job->rom, buffer, &size) != 0 || loadROMBuffer(c8, buffer, size) != 0) {
+        job->failed = 1;
+        return;
+    }
+    if (job->script[0] && (eventCount = readScript(job->script, &events)) < 0) {
+        fprintf(stderr, "Bad key script %s, lines are frame key down|up in frame order\n", job->script);
+        job->failed = 1;
+        return;
+    }
+    char key[600];
+    jobKey(job, key, sizeof(key));
+    if (w->regressMode != REGRESS_NONE) {
+        job->checks = malloc((job->frames / w->checkInterval + 1) * sizeof(checkpoint));
+    }
+
+#ifdef CHIP8_TRACE
+    if (w->useTrace) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/job%d.c8t", w->outDir, job->id);
+        if (traceStart(c8, path) != 0) {
+            fprintf(stderr, "Failed to create %s\n", path);
+        }
+    }
+#endif
+#ifdef CHIP8_PROFILE
+    if (w->useProfile && profileStart(c8) != 0) {
+        fprintf(stderr, "Out of memory for profile of job%d\n", job->id);
+    }
+#endif
+    uint64_t skippedBefore = c8->idleSkipped;
+    double start = nowSeconds();
+    int nextEvent = 0;
+    long frame = 0;
+    while (frame < job->frames) { //no delay between frames, run as fast as possible
+        for (; nextEvent < eventCount && events[nextEvent].frame <= frame; nextEvent++) {
+            setKey(c8, events[nextEvent].key, events[nextEvent].pressed);
+        }
+#ifdef CHIP8_JIT
+        if (w->useJit) jitStepInstructions(c8, job->IPF);
+        else
+#endif
+        stepInstructions(c8, job->IPF);
+        tickTimers(c8);
+        frame++;
+        if (w->regressMode != REGRESS_NONE && (frame % w->checkInterval == 0 || frame == job->frames)) {
+            checkpoint *check = &job->checks[job->checkCount++];
+            takeCheckpoint(c8, frame, check);
+            if (w->regressMode == REGRESS_COMPARE && (job->mismatch = checkGolden(w, key, check)) != NULL) {
+                break; //the rest would differ too, stop here so the output shows the first bad state
+            }
+        }
+    }
+    job->seconds = nowSeconds() - start;
+    free(events);
+#ifdef CHIP8_TRACE
+    traceStop(c8); //nothing if not tracing
+#endif
+#ifdef CHIP8_PROFILE
+    if (c8->profile) {
+        char report[512], folded[512];
+        snprintf(report, sizeof(report), "%s/job%d.profile.txt", w->outDir, job->id);
+        snprintf(folded, sizeof(folded), "%s/job%d.folded", w->outDir, job->id);
+        profileStop(c8, report, folded);
+    }
+#endif
+    job->skipped = (long long)(c8->idleSkipped - skippedBefore);
+    job->instructions = (long long)frame * job->IPF - job->skipped; //instructions/sec is a measure of the interpreter, idle skipping would inflate it by orders of magnitude
+    if (w->regressMode == REGRESS_NONE || job->mismatch) {
+        writeResults(w, job); //regression runs only keep output for jobs that went wrong
+    }
+}
+
+static void *workerMain(void *arg) {
+    fleetWorker *w = arg;
+#ifdef CHIP8_JIT
+    if (w->useJit && jitCreate(&w->machine) != 0) {
+        w->useJit = 0; //no recompiler on this platform, interpret instead
+    }
+#endif
+    for (;;) {
+        fleetJob *job = popBottom(&w->deques[w->index]);
+        for (int i = 1; job == NULL && i < w->workerCount; i++) { //own deque empty, try to steal from the others
+            job = stealTop(&w->deques[(w->index + i) % w->workerCount]);
+        }
+        if (job == NULL) {
+            break; //no jobs are added once started so nothing left anywhere means done
+        }
+        runJob(w, job);
+    }
+#ifdef CHIP8_JIT
+    jitDestroy(&w->machine);
+#endif
+    return NULL;
+}
+
+static int parseJobFile(const char *name, fleetJob **jobsOut) {
+    FILE *f = fopen(name, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    int count = 0, capacity = 16;
+    fleetJob *jobs = malloc(capacity * sizeof(fleetJob));
+    char line[512];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char rom[256], quirks[8] = "-", script[256] = "";
+        int IPF;
+        long frames;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        if (sscanf(line, "%255s %d %ld %7s %255s", rom, &IPF, &frames, quirks, script) < 3 || IPF < 0 || frames < 0) {
+            fprintf(stderr, "Skipping bad job on line %d\n", lineNumber);
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            jobs = realloc(jobs, capacity * sizeof(fleetJob));
+        }
+        fleetJob *job = &jobs[count];
+        memset(job, 0, sizeof(*job));
+        job->id = count;
+        strcpy(job->rom, rom);
+        job->IPF = IPF;
+        job->frames = frames;
+        job->loadStoreRegQuirk = strchr(quirks, 'l') != NULL;
+        job->spriteWrapClipQuirk = strchr(quirks, 'c') != NULL;
+        job->bitShiftQuirk = strchr(quirks, 's') != NULL;
+        strcpy(job->script, script);
+        count++;
+    }
+    fclose(f);
+    *jobsOut = jobs;
+    return count;
+}
+
+static int compareNames(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int isRomName(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot && (strcmp(dot, ".ch8") == 0 || strcmp(dot, ".c8") == 0 || strcmp(dot, ".sc8") == 0 || strcmp(dot, ".xo8") == 0);
+}
+
+static int listRomDirectory(const char *path, int IPF, long frames, fleetJob **jobsOut) { //one job per rom in name order, -1 if path isn't a directory
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+    int count = 0, capacity = 16;
+    char **names = malloc(capacity * sizeof(char *));
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!isRomName(entry->d_name)) continue;
+        if (count == capacity) {
+            capacity *= 2;
+            names = realloc(names, capacity * sizeof(char *));
+        }
+        names[count++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(char *), compareNames); //readdir order isn't fixed, job numbers should be
+
+    fleetJob *jobs = calloc(count > 0 ? count : 1, sizeof(fleetJob));
+    int jobCount = 0;
+    for (int i = 0; i < count; i++) {
+        fleetJob *job = &jobs[jobCount];
+        int stem = (int)(strrchr(names[i], '.') - names[i]); //isRomName made sure there's an extension
+        char script[sizeof(job->script)];
+        int romLength = snprintf(job->rom, sizeof(job->rom), "%s/%s", path, names[i]);
+        int scriptLength = snprintf(script, sizeof(script), "%s/%.*s.keys", path, stem, names[i]);
+        if (romLength < 0 || romLength >= (int)sizeof(job->rom) || scriptLength < 0 || scriptLength >= (int)sizeof(script)) {
+            fprintf(stderr, "Skipping %s/%s, path is too long\n", path, names[i]);
+            free(names[i]);
+            continue;
+        }
+        job->id = jobCount++;
+        job->IPF = IPF;
+        job->frames = frames;
+        FILE *f = fopen(script, "r");
+        if (f) {
+            fclose(f);
+            strcpy(job->script, script); //same size buffers, and it fitted
+        }
+        free(names[i]);
+    }
+    free(names);
+    *jobsOut = jobs;
+    return jobCount;
+}
+
+static int readGolden(const char *name, goldenEntry **entriesOut) { //returns how many checkpoints, sorted for checkGolden, -1 if it can't be read
+    FILE *f = fopen(name, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    int count = 0, capacity = 64;
+    goldenEntry *entries = malloc(capacity * sizeof(goldenEntry));
+    char line[768];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long display, state;
+        if (count == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, capacity * sizeof(goldenEntry));
+        }
+        goldenEntry *e = &entries[count];
+        if (line[0] == '#' || sscanf(line, "%599s %ld %llx %llx", e->job, &e->check.frame, &display, &state) != 4) continue;
+        e->check.displayHash = display;
+        e->check.stateHash = state;
+        count++;
+    }
+    fclose(f);
+    qsort(entries, count, sizeof(goldenEntry), compareGolden);
+    *entriesOut = entries;
+    return count;
+}
+
+static int writeGolden(const char *name, const fleetJob *jobs, int jobCount) { //returns 0 on success, -1 if it couldn't be written
+    FILE *f = fopen(name, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f, "# chip8fleet golden checkpoints: rom:ipf:frames:quirks[:script] frame display-hash register-hash\n");
+    for (int i = 0; i < jobCount; i++) {
+        char key[600];
+        jobKey(&jobs[i], key, sizeof(key));
+        for (int c = 0; c < jobs[i].checkCount; c++) {
+            const checkpoint *check = &jobs[i].checks[c];
+            fprintf(f, "%s %ld %016llx %016llx\n", key, check->frame, (unsigned long long)check->displayHash, (unsigned long long)check->stateHash);
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int coreCount() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    const char *jobFile = NULL;
+    const char *outDir = ".";
+    int threads = coreCount();
+    int useJit = 0;
+    int useTrace = 0;
+    int useProfile = 0;
+    int regressMode = REGRESS_NONE;
+    const char *goldenFile = NULL;
+    int checkInterval = 60;
+    int directoryIPF = 10;
+    long directoryFrames = 600;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-g") == 0 || strcmp(argv[i], "-G") == 0) && i + 1 < argc) {
+            regressMode = argv[i][1] == 'g' ? REGRESS_COMPARE : REGRESS_UPDATE;
+            goldenFile = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            checkInterval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            directoryIPF = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            directoryFrames = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0) {
+#ifdef CHIP8_JIT
+            useJit = 1;
+#else
+            fprintf(stderr, "Built without CHIP8_JIT, ignoring -j\n");
+#endif
+        } else if (strcmp(argv[i], "-T") == 0) {
+#ifdef CHIP8_TRACE
+            useTrace = 1;
+#else
+            fprintf(stderr, "Built without CHIP8_TRACE, ignoring -T\n");
+#endif
+        } else if (strcmp(argv[i], "-P") == 0) {
+#ifdef CHIP8_PROFILE
+            useProfile = 1;
+#else
+            fprintf(stderr, "Built without CHIP8_PROFILE, ignoring -P\n");
+#endif
+        } else {
+            jobFile = argv[i];
+        }
+    }
+    if (jobFile == NULL || threads < 1 || checkInterval < 1 || directoryIPF < 0 || directoryFrames < 0) {
+        fprintf(stderr, "Usage: %s jobs.txt|romdir [-t threads] [-o outdir] [-j] [-T] [-P] [-g|-G golden.txt] [-c frames] [-i ipf] [-f frames]\n", argv[0]);
+        return 1;
+    }
+
+    fleetJob *jobs;
+    int jobCount = listRomDirectory(jobFile, directoryIPF, directoryFrames, &jobs);
+    if (jobCount < 0) {
+        jobCount = parseJobFile(jobFile, &jobs);
+    }
+    if (jobCount < 0) {
+        fprintf(stderr, "Failed to open job file\n");
+        return 1;
+    }
+    goldenEntry *golden = NULL;
+    int goldenCount = 0;
+    if (regressMode == REGRESS_COMPARE && (goldenCount = readGolden(goldenFile, &golden)) < 0) {
+        fprintf(stderr, "Failed to open %s, make it with -G\n", goldenFile);
+        return 1;
+    }
+    if (useJit && (useTrace || useProfile)) {
+        fprintf(stderr, "Compiled blocks aren't traced or profiled, -T and -P turn off -j\n");
+        useJit = 0;
+    }
+    if (threads > jobCount && jobCount > 0) threads = jobCount; //no point having idle workers
+
+    jobDeque *deques = calloc(threads, sizeof(jobDeque));
+    fleetWorker *workers = calloc(threads, sizeof(fleetWorker)); //heap, each worker has a whole machine in it
+    pthread_t *handles = malloc(threads * sizeof(pthread_t));
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].jobs = malloc((jobCount / threads + 1) * sizeof(fleetJob *));
+    }
+    for (int i = 0; i < jobCount; i++) { //deal jobs out round robin, stealing evens out the rest
+        jobDeque *d = &deques[i % threads];
+        d->jobs[d->bottom++] = &jobs[i];
+    }
+
+    double start = nowSeconds();
+    for (int i = 0; i < threads; i++) {
+        workers[i].index = i;
+        workers[i].workerCount = threads;
+        workers[i].deques = deques;
+        workers[i].outDir = outDir;
+        workers[i].useJit = useJit;
+        workers[i].useTrace = useTrace;
+        workers[i].useProfile = useProfile;
+        workers[i].regressMode = regressMode;
+        workers[i].checkInterval = checkInterval;
+        workers[i].golden = golden;
+        workers[i].goldenCount = goldenCount;
+        pthread_create(&handles[i], NULL, workerMain, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    double total = nowSeconds() - start;
+
+    long long totalInstructions = 0, totalSkipped = 0;
+    int failures = 0;
+    for (int i = 0; i < jobCount; i++) { //summary in job file order
+        fleetJob *job = &jobs[i];
+        if (job->failed) {
+            printf("job%d %s FAILED to load\n", job->id, job->rom);
+            failures++;
+            continue;
+        }
+        totalInstructions += job->instructions;
+        totalSkipped += job->skipped;
+        if (job->mismatch) {
+            printf("job%d %s FAILED at frame %ld, %s\n", job->id, job->rom, job->checks[job->checkCount - 1].frame, job->mismatch);
+            failures++;
+        } else if (regressMode == REGRESS_NONE) { //regression runs only list what went wrong
+            printf("job%d %s ipf=%d frames=%ld instructions=%lld skipped=%lld ips=%.0f\n", job->id, job->rom, job->IPF, job->frames, job->instructions, job->skipped, job->seconds > 0 ? job->instructions / job->seconds : 0.0);
+        }
+    }
+    printf("%d jobs on %d threads in %.3fs, %lld instructions (%lld more skipped in idle loops), %.0f instructions/sec total\n", jobCount, threads, total, totalInstructions, totalSkipped, total > 0 ? totalInstructions / total : 0.0);
+    if (regressMode == REGRESS_COMPARE) {
+        printf("%d of %d jobs match %s\n", jobCount - failures, jobCount, goldenFile);
+    } else if (regressMode == REGRESS_UPDATE) {
+        if (writeGolden(goldenFile, jobs, jobCount) != 0) {
+            fprintf(stderr, "Failed to write %s\n", goldenFile);
+            failures++;
+        } else {
+            printf("Wrote golden checkpoints for %d jobs to %s\n", jobCount - failures, goldenFile);
+        }
+    }
+
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&deques[i].lock);
+        free(deques[i].jobs);
+    }
+    free(deques);
+    free(workers);
+    free(handles);
+    for (int i = 0; i < jobCount; i++) {
+        free(jobs[i].checks);
+    }
+    free(jobs);
+    free(golden);
+    return failures ? 1 : 0;
+}
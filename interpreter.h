@@ -0,0 +1,120 @@
+// Not a normal header, chip8.c includes this once for every combination of quirks to build one stepInstructions per combination.
+// before including define:
+//   INTERPRETER_NAME   name of the function to build
+//   QUIRK_LOAD_STORE   0 or 1, loadStoreRegQuirk this version runs with
+//   QUIRK_CLIP         0 or 1, spriteWrapClipQuirk
+//   QUIRK_SHIFT        0 or 1, bitShiftQuirk
+// the quirks are constants in here so the checks for them are compiled out of the hot loop, all four are undefined again at the end
+
+static void INTERPRETER_NAME(chip8 *c8, int count) {
+#if defined(__GNUC__)
+    static void *const dispatchTable[] = {
+        &&L_H_UNDECODED, &&L_H_00E0, &&L_H_00EE, &&L_H_0NNN, &&L_H_1NNN, &&L_H_2NNN, &&L_H_3XNN, &&L_H_4XNN, &&L_H_5XY0, &&L_H_6XNN, &&L_H_7XNN,
+        &&L_H_8XY0, &&L_H_8XY1, &&L_H_8XY2, &&L_H_8XY3, &&L_H_8XY4, &&L_H_8XY5, &&L_H_8XY6, &&L_H_8XY7, &&L_H_8XYE, &&L_H_9XY0,
+        &&L_H_ANNN, &&L_H_BNNN, &&L_H_CXNN, &&L_H_DXYN, &&L_H_EX9E, &&L_H_EXA1,
+        &&L_H_FX07, &&L_H_FX0A, &&L_H_FX15, &&L_H_FX18, &&L_H_FX1E, &&L_H_FX29, &&L_H_FX33, &&L_H_FX55, &&L_H_FX65,
+        &&L_H_00CN, &&L_H_00DN, &&L_H_00FB, &&L_H_00FC, &&L_H_00FD, &&L_H_00FE, &&L_H_00FF, &&L_H_5XY2, &&L_H_5XY3, &&L_H_DXY0, &&L_H_FN01, &&L_H_FX30, &&L_H_FX75, &&L_H_FX85,
+        &&L_H_UNKNOWN,
+        &&L_H_IDLE_LOOP, &&L_H_BREAK
+    };
+#endif
+    decodedInstruction *d;
+    uint16_t pc;
+
+next:
+    pc = c8->regs.PC;
+    if (pc & 1) { //odd addresses aren't cached, rare so just take the slow path
+        if (c8->breaks.armed && breakAt(c8, pc, handlerFor(opcodeAt(c8, pc)))) { //so they can't be marked, check here
+            stopBefore(c8, pc, handlerFor(opcodeAt(c8, pc)), count);
+            return;
+        }
+        fetchDecodeExecute(c8);
+        NEXT();
+    }
+    pc &= 0xFFF;
+    d = &c8->decoded[pc >> 1];
+    c8->lastInstruction = d->opcode;
+    c8->regs.PC += 2; //set PC to next sequential instruction, executed instruction can change this potentially
+#if defined(__GNUC__)
+    DISPATCH();
+#else
+dispatch:
+    switch (d->handler) {
+#endif
+
+    HANDLER(H_UNDECODED) predecode(c8, d, pc); c8->lastInstruction = d->opcode; DISPATCH();
+    HANDLER(H_00E0) op_00E0(c8); NEXT();
+    HANDLER(H_00EE) op_00EE(c8); NEXT();
+    HANDLER(H_0NNN) op_0NNN(c8, d->NNN); NEXT();
+    HANDLER(H_1NNN) op_1NNN(c8, d->NNN); NEXT();
+    HANDLER(H_2NNN) op_2NNN(c8, d->NNN); NEXT();
+    HANDLER(H_3XNN) op_3XNN(c8, d->X, d->NN); NEXT();
+    HANDLER(H_4XNN) op_4XNN(c8, d->X, d->NN); NEXT();
+    HANDLER(H_5XY0) op_5XY0(c8, d->X, d->Y); NEXT();
+    HANDLER(H_6XNN) op_6XNN(c8, d->X, d->NN); NEXT();
+    HANDLER(H_7XNN) op_7XNN(c8, d->X, d->NN); NEXT();
+    HANDLER(H_8XY0) op_8XY0(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XY1) op_8XY1(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XY2) op_8XY2(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XY3) op_8XY3(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XY4) op_8XY4(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XY5) op_8XY5(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XY6) shiftRight(c8, d->X, d->Y, QUIRK_SHIFT); NEXT();
+    HANDLER(H_8XY7) op_8XY7(c8, d->X, d->Y); NEXT();
+    HANDLER(H_8XYE) shiftLeft(c8, d->X, d->Y, QUIRK_SHIFT); NEXT();
+    HANDLER(H_9XY0) op_9XY0(c8, d->X, d->Y); NEXT();
+    HANDLER(H_ANNN) op_ANNN(c8, d->NNN); NEXT();
+    HANDLER(H_BNNN) op_BNNN(c8, d->NNN); NEXT();
+    HANDLER(H_CXNN) op_CXNN(c8, d->X, d->NN); NEXT();
+    HANDLER(H_DXYN) drawSprite(c8, d->X, d->Y, d->NN & 0x0F, QUIRK_CLIP); NEXT();
+    HANDLER(H_EX9E) op_EX9E(c8, d->X); NEXT();
+    HANDLER(H_EXA1) op_EXA1(c8, d->X); NEXT();
+    HANDLER(H_FX07) op_FX07(c8, d->X); NEXT();
+    HANDLER(H_FX0A)
+        op_FX0A(c8, d->X);
+        c8->idleSkipped += count - 1; //waits until a key is pressed and released, which can only happen between calls
+        c8->idle = 1;
+        return;
+    HANDLER(H_FX15) op_FX15(c8, d->X); NEXT();
+    HANDLER(H_FX18) op_FX18(c8, d->X); NEXT();
+    HANDLER(H_FX1E) op_FX1E(c8, d->X); NEXT();
+    HANDLER(H_FX29) op_FX29(c8, d->X); NEXT();
+    HANDLER(H_FX33) op_FX33(c8, d->X); NEXT();
+    HANDLER(H_FX55) storeRegisters(c8, d->X, QUIRK_LOAD_STORE); NEXT();
+    HANDLER(H_FX65) loadRegisters(c8, d->X, QUIRK_LOAD_STORE); NEXT();
+    HANDLER(H_00CN) op_00CN(c8, d->NN & 0x0F); NEXT();
+    HANDLER(H_00DN) op_00DN(c8, d->NN & 0x0F); NEXT();
+    HANDLER(H_00FB) op_00FB(c8); NEXT();
+    HANDLER(H_00FC) op_00FC(c8); NEXT();
+    HANDLER(H_00FD)
+        op_00FD(c8);
+        c8->idleSkipped += count - 1; //stays on 00FD for good, the rest of the call would just run it again
+        c8->idle = 1;
+        return;
+    HANDLER(H_00FE) op_00FE(c8); NEXT();
+    HANDLER(H_00FF) op_00FF(c8); NEXT();
+    HANDLER(H_5XY2) op_5XY2(c8, d->X, d->Y); NEXT();
+    HANDLER(H_5XY3) op_5XY3(c8, d->X, d->Y); NEXT();
+    HANDLER(H_DXY0) drawSprite(c8, d->X, d->Y, 0, QUIRK_CLIP); NEXT();
+    HANDLER(H_FN01) op_FN01(c8, d->X); NEXT();
+    HANDLER(H_FX30) op_FX30(c8, d->X); NEXT();
+    HANDLER(H_FX75) op_FX75(c8, d->X); NEXT();
+    HANDLER(H_FX85) op_FX85(c8, d->X); NEXT();
+    HANDLER(H_UNKNOWN) printf("Unknown opcode: 0x%04X\n", d->opcode); NEXT();
+    HANDLER(H_IDLE_LOOP)
+        op_1NNN(c8, d->NNN);
+        if (count > 1 && pc != c8->idleMiss) count = fastForwardLoop(c8, pc, count - 1) + 1;
+        NEXT();
+    HANDLER(H_BREAK)
+        c8->regs.PC -= 2; //stop before it runs
+        stopBefore(c8, pc, handlerFor(d->opcode), count);
+        return;
+#if !defined(__GNUC__)
+    }
+#endif
+}
+
+#undef INTERPRETER_NAME
+#undef QUIRK_LOAD_STORE
+#undef QUIRK_CLIP
+#undef QUIRK_SHIFT
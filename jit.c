@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h> //for offsetof
+#include "chip8.h"
+#include "jit.h"
+
+// Basic block recompiler for x86-64
+// a block starts at an even PC and runs straight through ALU/load/timer instructions until it hits a jump, call, return or skip,
+// which it also translates and then exits with PC set. V registers the block uses are loaded into host registers at the start
+// and written back at the end. Instructions it doesn't translate end the block before them and are run by the interpreter.
+// Blocks are cached per start address and dropped when FX33/FX55 (or a rom load) write over them.
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#ifdef _WIN32
+#include <windows.h> //VirtualAlloc for executable memory
+#else
+#include <sys/mman.h> //mmap for executable memory
+#endif
+
+#define JIT_CODE_SIZE (1 << 20) //1MB of code, whole cache is flushed when it fills up
+#define JIT_MAX_BLOCK 64 //max instructions per block
+#define JIT_MAX_BLOCK_BYTES (JIT_MAX_BLOCK * 2)
+#define JIT_MAX_BLOCK_CODE (JIT_MAX_BLOCK * 48 + 512) //worst case bytes of x86 per block, checked before compiling
+
+typedef int (*blockFunction)(chip8 *c8); //returns how many chip8 instructions it ran
+
+typedef struct {
+    blockFunction code; //NULL if not compiled yet
+    uint16_t end; //one past last byte of chip8 code in the block
+    uint8_t length; //instructions in block, 0 means first instruction can't be compiled so interpret it
+    uint8_t compiled; //1 once looked at, even if length is 0
+} jitBlock;
+
+struct chip8Jit {
+    uint8_t *code; //executable buffer
+    size_t used;
+    jitBlock blocks[CHIP8_MEMORY_SIZE / 2]; //one per even start address
+    uint64_t codePages; //bit per 64 byte page of chip8 memory that has compiled code in it, so most writes skip the block search
+    int bitShiftQuirk; //quirk value blocks were compiled with, 8XY6/8XYE are translated for one setting
+};
+
+// host registers: rax, rcx, rdx are scratch, rbx holds the chip8 pointer, the rest can hold V registers
+enum { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7, R8, R9, R10, R11, R12, R13, R14, R15 };
+static const uint8_t vHostRegs[] = { RSI, RDI, RBP, R8, R9, R10, R11, R12, R13, R14, R15 };
+#define JIT_HOST_REGS ((int)sizeof(vHostRegs))
+static const uint8_t savedRegs[] = { RBX, RBP, R12, R13, R14, R15, RSI, RDI }; //callee saved in either the SysV or Windows ABI
+
+#define OFF_V(i) ((int)(offsetof(chip8, regs.V) + (i)))
+#define OFF_I ((int)offsetof(chip8, regs.I))
+#define OFF_DT ((int)offsetof(chip8, regs.DT))
+#define OFF_ST ((int)offsetof(chip8, regs.ST))
+#define OFF_PC ((int)offsetof(chip8, regs.PC))
+#define OFF_SP ((int)offsetof(chip8, regs.SP))
+#define OFF_STACK ((int)offsetof(chip8, stack))
+#define OFF_LAST ((int)offsetof(chip8, lastInstruction))
+
+// x86 alu opcodes (r/m32, r32 form) and their /digit for the immediate form
+enum { ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29, ALU_XOR = 0x31, ALU_CMP = 0x39, ALU_MOV = 0x89 };
+enum { IMM_ADD = 0, IMM_OR = 1, IMM_AND = 4, IMM_SUB = 5, IMM_XOR = 6, IMM_CMP = 7 };
+enum { CC_E = 0x4, CC_NE = 0x5, CC_AE = 0x3, CC_A = 0x7 }; //condition codes for setcc/cmovcc/jcc
+
+typedef struct {
+    uint8_t *p;
+} emitter;
+
+static void emit8(emitter *e, uint8_t b) { *e->p++ = b; }
+static void emit16(emitter *e, uint16_t v) { emit8(e, v & 0xFF); emit8(e, v >> 8); }
+static void emit32(emitter *e, uint32_t v) { emit16(e, v & 0xFFFF); emit16(e, v >> 16); }
+
+static void emitRex(emitter *e, int w, int reg, int rm, int force) { //force is for byte registers sil/dil/bpl which need a rex prefix to be addressable
+    uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40 || force) emit8(e, rex);
+}
+static void emitModRegReg(emitter *e, int reg, int rm) { emit8(e, 0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+static void emitModMem(emitter *e, int reg, int disp) { emit8(e, 0x80 | ((reg & 7) << 3) | RBX); emit32(e, disp); } //[rbx + disp32]
+static void emitModMemIndexed(emitter *e, int reg, int disp) { emit8(e, 0x84 | ((reg & 7) << 3)); emit8(e, 0x43); emit32(e, disp); } //[rbx + rax*2 + disp32]
+
+static void movImm(emitter *e, int dst, uint32_t imm) { emitRex(e, 0, 0, dst, 0); emit8(e, 0xB8 + (dst & 7)); emit32(e, imm); }
+static void aluReg(emitter *e, int op, int dst, int src) { emitRex(e, 0, src, dst, 0); emit8(e, op); emitModRegReg(e, src, dst); }
+static void aluImm(emitter *e, int digit, int dst, uint32_t imm) { emitRex(e, 0, 0, dst, 0); emit8(e, 0x81); emitModRegReg(e, digit, dst); emit32(e, imm); }
+static void shiftImm(emitter *e, int digit, int dst, uint8_t amount) { emitRex(e, 0, 0, dst, 0); emit8(e, 0xC1); emitModRegReg(e, digit, dst); emit8(e, amount); } //shl /4, shr /5
+static void setcc(emitter *e, int cc, int dst) { emitRex(e, 0, 0, dst, 1); emit8(e, 0x0F); emit8(e, 0x90 | cc); emitModRegReg(e, 0, dst); }
+static void cmovcc(emitter *e, int cc, int dst, int src) { emitRex(e, 0, dst, src, 0); emit8(e, 0x0F); emit8(e, 0x40 | cc); emitModRegReg(e, dst, src); }
+static void loadByte(emitter *e, int dst, int disp) { emitRex(e, 0, dst, 0, 0); emit8(e, 0x0F); emit8(e, 0xB6); emitModMem(e, dst, disp); } //movzx
+static void storeByte(emitter *e, int disp, int src) { emitRex(e, 0, src, 0, 1); emit8(e, 0x88); emitModMem(e, src, disp); }
+static void loadWord(emitter *e, int dst, int disp) { emitRex(e, 0, dst, 0, 0); emit8(e, 0x0F); emit8(e, 0xB7); emitModMem(e, dst, disp); } //movzx
+static void storeWord(emitter *e, int disp, int src) { emit8(e, 0x66); emitRex(e, 0, src, 0, 0); emit8(e, 0x89); emitModMem(e, src, disp); }
+static void storeWordImm(emitter *e, int disp, uint16_t imm) { emit8(e, 0x66); emit8(e, 0xC7); emitModMem(e, 0, disp); emit16(e, imm); }
+static void push(emitter *e, int r) { emitRex(e, 0, 0, r, 0); emit8(e, 0x50 + (r & 7)); }
+static void pop(emitter *e, int r) { emitRex(e, 0, 0, r, 0); emit8(e, 0x58 + (r & 7)); }
+static uint8_t *jcc(emitter *e, int cc) { emit8(e, 0x0F); emit8(e, 0x80 | cc); emit32(e, 0); return e->p - 4; } //returns where to patch the target
+static void patchJump(uint8_t *at, uint8_t *target) { int32_t rel = (int32_t)(target - (at + 4)); memcpy(at, &rel, 4); }
+
+typedef enum { KIND_NONE, KIND_STRAIGHT, KIND_END } instructionKind;
+
+static instructionKind classify(uint16_t opcode, uint8_t *usesX, uint8_t *usesY, uint8_t *usesF, uint8_t *usesV0) { //what the block compiler can do with this instruction and which registers it touches
+    uint8_t N = opcode & 0x000F;
+    uint8_t NN = opcode & 0x00FF;
+    *usesX = *usesY = *usesF = *usesV0 = 0;
+    switch (opcode >> 12) {
+        case 0x0: return opcode == 0x00EE ? KIND_END : KIND_NONE; //00E0 and 0NNN are left to the interpreter
+        case 0x1: case 0x2: return KIND_END;
+        case 0x3: case 0x4: *usesX = 1; return KIND_END;
+        case 0x5: case 0x9: if (N != 0) return KIND_NONE; *usesX = *usesY = 1; return KIND_END;
+        case 0x6: case 0x7: *usesX = 1; return KIND_STRAIGHT;
+        case 0x8:
+            if (N > 7 && N != 0xE) return KIND_NONE;
+            *usesX = *usesY = 1;
+            *usesF = (N >= 4); //4,5,6,7,E set VF
+            return KIND_STRAIGHT;
+        case 0xA: return KIND_STRAIGHT;
+        case 0xB: *usesV0 = 1; return KIND_END;
+        case 0xF:
+            if (NN == 0x07 || NN == 0x15 || NN == 0x18 || NN == 0x1E) { *usesX = 1; return KIND_STRAIGHT; }
+            return KIND_NONE;
+        default: return KIND_NONE; //CXNN, DXYN, EX9E, EXA1 go to the interpreter
+    }
+}
+
+typedef struct {
+    emitter e;
+    int8_t host[16]; //host register holding each V register, -1 if not used in block
+    int hostCount;
+    struct chip8Jit *jit;
+} blockCompiler;
+
+static int allocate(blockCompiler *bc, int v) { //make sure V register has a host register, returns 0 if out of registers
+    if (bc->host[v] >= 0) return 1;
+    if (bc->hostCount == JIT_HOST_REGS) return 0;
+    bc->host[v] = vHostRegs[bc->hostCount++];
+    return 1;
+}
+
+static void emitExit(blockCompiler *bc, uint16_t lastOpcode, int count) { //write V registers back, set lastInstruction and return count
+    emitter *e = &bc->e;
+    for (int v = 0; v < 16; v++) {
+        if (bc->host[v] >= 0) storeByte(e, OFF_V(v), bc->host[v]);
+    }
+    storeWordImm(e, OFF_LAST, lastOpcode);
+    movImm(e, RAX, count);
+    for (int i = (int)sizeof(savedRegs) - 1; i >= 0; i--) pop(e, savedRegs[i]);
+    emit8(e, 0xC3); //ret
+}
+
+static void emitStraight(blockCompiler *bc, uint16_t opcode) { //instructions that just fall through to the next one
+    emitter *e = &bc->e;
+    uint8_t N = opcode & 0x000F;
+    uint8_t NN = opcode & 0x00FF;
+    int vx = bc->host[(opcode & 0x0F00) >> 8];
+    int vy = bc->host[(opcode & 0x00F0) >> 4];
+    int vf = bc->host[0xF];
+    switch (opcode >> 12) {
+        case 0x6: movImm(e, vx, NN); break;
+        case 0x7: aluImm(e, IMM_ADD, vx, NN); aluImm(e, IMM_AND, vx, 0xFF); break;
+        case 0x8:
+            switch (N) { //same order of register writes as the interpreter so VF as X or Y behaves the same
+                case 0x0: aluReg(e, ALU_MOV, vx, vy); break;
+                case 0x1: aluReg(e, ALU_OR, vx, vy); break;
+                case 0x2: aluReg(e, ALU_AND, vx, vy); break;
+                case 0x3: aluReg(e, ALU_XOR, vx, vy); break;
+                case 0x4: //VF = carry of VX + VY, then VX = VX + VY
+                    aluReg(e, ALU_MOV, RAX, vx); aluReg(e, ALU_ADD, RAX, vy);
+                    aluReg(e, ALU_XOR, RCX, RCX); aluImm(e, IMM_CMP, RAX, 0xFF); setcc(e, CC_A, RCX);
+                    aluReg(e, ALU_MOV, vf, RCX);
+                    aluReg(e, ALU_ADD, vx, vy); aluImm(e, IMM_AND, vx, 0xFF);
+                    break;
+                case 0x5: //VF = VX > VY, then VX = VX - VY
+                    aluReg(e, ALU_XOR, RCX, RCX); aluReg(e, ALU_CMP, vx, vy); setcc(e, CC_A, RCX);
+                    aluReg(e, ALU_MOV, vf, RCX);
+                    aluReg(e, ALU_SUB, vx, vy); aluImm(e, IMM_AND, vx, 0xFF);
+                    break;
+                case 0x7: //VF = VY > VX, then VX = VY - VX
+                    aluReg(e, ALU_XOR, RCX, RCX); aluReg(e, ALU_CMP, vy, vx); setcc(e, CC_A, RCX);
+                    aluReg(e, ALU_MOV, vf, RCX);
+                    aluReg(e, ALU_MOV, RAX, vy); aluReg(e, ALU_SUB, RAX, vx); aluImm(e, IMM_AND, RAX, 0xFF);
+                    aluReg(e, ALU_MOV, vx, RAX);
+                    break;
+                case 0x6: { //VF = lsb, then shift right, source is VY or VX depending on bitShiftQuirk
+                    int src = bc->jit->bitShiftQuirk == 0 ? vy : vx;
+                    aluReg(e, ALU_MOV, RAX, src); aluImm(e, IMM_AND, RAX, 0x01); aluReg(e, ALU_MOV, vf, RAX);
+                    aluReg(e, ALU_MOV, RAX, src); shiftImm(e, 5, RAX, 1); aluReg(e, ALU_MOV, vx, RAX);
+                    break;
+                }
+                case 0xE: { //VF = msb, then shift left
+                    int src = bc->jit->bitShiftQuirk == 0 ? vy : vx;
+                    aluReg(e, ALU_MOV, RAX, src); shiftImm(e, 5, RAX, 7); aluReg(e, ALU_MOV, vf, RAX);
+                    aluReg(e, ALU_MOV, RAX, src); shiftImm(e, 4, RAX, 1); aluImm(e, IMM_AND, RAX, 0xFF); aluReg(e, ALU_MOV, vx, RAX);
+                    break;
+                }
+            }
+            break;
+        case 0xA: storeWordImm(e, OFF_I, opcode & 0x0FFF); break;
+        case 0xF:
+            switch (NN) {
+                case 0x07: loadByte(e, vx, OFF_DT); break;
+                case 0x15: storeByte(e, OFF_DT, vx); break;
+                case 0x18: storeByte(e, OFF_ST, vx); break;
+                case 0x1E: loadWord(e, RAX, OFF_I); aluReg(e, ALU_ADD, RAX, vx); storeWord(e, OFF_I, RAX); break;
+            }
+            break;
+    }
+}
+
+static void emitEnd(blockCompiler *bc, uint16_t opcode, uint16_t address, uint16_t previousOpcode, int count) { //jump/call/return/skip that ends the block
+    emitter *e = &bc->e;
+    uint16_t NNN = opcode & 0x0FFF;
+    uint8_t NN = opcode & 0x00FF;
+    int vx = bc->host[(opcode & 0x0F00) >> 8];
+    int vy = bc->host[(opcode & 0x00F0) >> 4];
+    uint8_t *bail = NULL; //2NNN/00EE jump here if the stack would over/underflow, interpreter runs them so it prints the error
+    switch (opcode >> 12) {
+        case 0x0: //00EE return
+            loadByte(e, RAX, OFF_SP);
+            aluImm(e, IMM_CMP, RAX, 0);
+            bail = jcc(e, CC_E);
+            aluImm(e, IMM_SUB, RAX, 1);
+            storeByte(e, OFF_SP, RAX);
+            emitRex(e, 0, RCX, 0, 0); emit8(e, 0x0F); emit8(e, 0xB7); emitModMemIndexed(e, RCX, OFF_STACK); //movzx ecx, word [rbx + rax*2 + stack]
+            storeWord(e, OFF_PC, RCX);
+            break;
+        case 0x1: storeWordImm(e, OFF_PC, NNN); break;
+        case 0x2: //call
+            loadByte(e, RAX, OFF_SP);
+            aluImm(e, IMM_CMP, RAX, 15);
+            bail = jcc(e, CC_AE);
+            emit8(e, 0x66); emit8(e, 0xC7); emitModMemIndexed(e, 0, OFF_STACK); emit16(e, address + 2); //mov word [rbx + rax*2 + stack], return address
+            aluImm(e, IMM_ADD, RAX, 1);
+            storeByte(e, OFF_SP, RAX);
+            storeWordImm(e, OFF_PC, NNN);
+            break;
+        case 0xB: aluReg(e, ALU_MOV, RAX, bc->host[0]); aluImm(e, IMM_ADD, RAX, NNN); storeWord(e, OFF_PC, RAX); break;
+        default: { //skips, PC = address + 4 if condition holds else address + 2
+            int cc = ((opcode >> 12) == 0x3 || (opcode >> 12) == 0x5) ? CC_E : CC_NE;
+            movImm(e, RAX, address + 2);
+            movImm(e, RCX, address + 4);
+            if ((opcode >> 12) == 0x3 || (opcode >> 12) == 0x4) aluImm(e, IMM_CMP, vx, NN);
+            else aluReg(e, ALU_CMP, vx, vy);
+            cmovcc(e, cc, RAX, RCX);
+            storeWord(e, OFF_PC, RAX);
+            break;
+        }
+    }
+    emitExit(bc, opcode, count);
+    if (bail) {
+        patchJump(bail, e->p);
+        storeWordImm(e, OFF_PC, address); //stop before the call/return
+        emitExit(bc, previousOpcode, count - 1);
+    }
+}
+
+static void compileBlock(chip8 *c8, struct chip8Jit *jit, uint16_t start) {
+    jitBlock *block = &jit->blocks[start >> 1];
+    uint16_t opcodes[JIT_MAX_BLOCK];
+    instructionKind kinds[JIT_MAX_BLOCK];
+    blockCompiler bc;
+    memset(bc.host, -1, sizeof(bc.host));
+    bc.hostCount = 0;
+    bc.jit = jit;
+
+    //find the block and which V registers it needs
+    int length = 0;
+    uint16_t address = start;
+    while (length < JIT_MAX_BLOCK && address <= 0xFFE) {
+        uint16_t opcode = (c8->mainMemory[address] << 8) | c8->mainMemory[address + 1];
+        uint8_t usesX, usesY, usesF, usesV0;
+        instructionKind kind = classify(opcode, &usesX, &usesY, &usesF, &usesV0);
+        if (kind == KIND_NONE) break;
+        int8_t savedHost[16]; //undo allocation if this instruction doesn't fit
+        memcpy(savedHost, bc.host, sizeof(savedHost));
+        int savedCount = bc.hostCount;
+        if ((usesX && !allocate(&bc, (opcode >> 8) & 0xF)) || (usesY && !allocate(&bc, (opcode >> 4) & 0xF)) ||
+            (usesF && !allocate(&bc, 0xF)) || (usesV0 && !allocate(&bc, 0))) {
+            memcpy(bc.host, savedHost, sizeof(savedHost));
+            bc.hostCount = savedCount;
+            break; //out of host registers, end block here
+        }
+        opcodes[length] = opcode;
+        kinds[length] = kind;
+        length++;
+        address += 2;
+        if (kind == KIND_END) break;
+    }
+
+    block->compiled = 1;
+    block->length = length;
+    block->end = address;
+    if (length == 0) return; //first instruction needs the interpreter
+
+    if (jit->used + JIT_MAX_BLOCK_CODE > JIT_CODE_SIZE) { //out of code space, start again
+        jitFlush(c8);
+        block->compiled = 1;
+        block->length = length;
+        block->end = address;
+    }
+
+    bc.e.p = jit->code + jit->used;
+    uint8_t *entry = bc.e.p;
+    for (int i = 0; i < (int)sizeof(savedRegs); i++) push(&bc.e, savedRegs[i]);
+#ifdef _WIN32
+    emit8(&bc.e, 0x48); emit8(&bc.e, 0x89); emit8(&bc.e, 0xCB); //mov rbx, rcx (first argument on windows)
+#else
+    emit8(&bc.e, 0x48); emit8(&bc.e, 0x89); emit8(&bc.e, 0xFB); //mov rbx, rdi (first argument on sysv)
+#endif
+    for (int v = 0; v < 16; v++) {
+        if (bc.host[v] >= 0) loadByte(&bc.e, bc.host[v], OFF_V(v));
+    }
+
+    address = start;
+    for (int i = 0; i < length; i++) {
+        if (kinds[i] == KIND_END) {
+            emitEnd(&bc, opcodes[i], address, i > 0 ? opcodes[i - 1] : opcodes[i], length); //bailing on the first instruction returns 0 and the interpreter runs it, so lastInstruction is set again there
+        } else {
+            emitStraight(&bc, opcodes[i]);
+        }
+        address += 2;
+    }
+    if (kinds[length - 1] != KIND_END) { //ran into something the interpreter has to do, fall through to it
+        storeWordImm(&bc.e, OFF_PC, address);
+        emitExit(&bc, opcodes[length - 1], length);
+    }
+
+    jit->used = bc.e.p - jit->code;
+    block->code = (blockFunction)(void *)entry;
+    for (uint16_t page = start >> 6; page <= ((block->end - 1) >> 6); page++) {
+        jit->codePages |= 1ull << page;
+    }
+}
+
+int jitCreate(chip8 *c8) {
+    struct chip8Jit *jit = calloc(1, sizeof(struct chip8Jit));
+    if (jit == NULL) return -1;
+#ifdef _WIN32
+    jit->code = VirtualAlloc(NULL, JIT_CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+    jit->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) jit->code = NULL;
+#endif
+    if (jit->code == NULL) {
+        free(jit);
+        return -1;
+    }
+    jit->bitShiftQuirk = c8->bitShiftQuirk;
+    c8->jit = jit;
+    return 0;
+}
+
+void jitDestroy(chip8 *c8) {
+    if (c8->jit == NULL) return;
+#ifdef _WIN32
+    VirtualFree(c8->jit->code, 0, MEM_RELEASE);
+#else
+    munmap(c8->jit->code, JIT_CODE_SIZE);
+#endif
+    free(c8->jit);
+    c8->jit = NULL;
+}
+
+void jitFlush(chip8 *c8) {
+    struct chip8Jit *jit = c8->jit;
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+    jit->used = 0;
+    jit->codePages = 0;
+}
+
+void jitInvalidate(chip8 *c8, uint16_t address, int length) {
+    struct chip8Jit *jit = c8->jit;
+    address &= 0xFFF;
+    uint16_t last = (address + length - 1) & 0xFFF;
+    if (last < address) { //write wrapped around the end of memory, do both halves
+        jitInvalidate(c8, 0, last + 1);
+        last = 0xFFF;
+    }
+    int touched = 0;
+    for (uint16_t page = address >> 6; page <= (last >> 6); page++) {
+        if (jit->codePages & (1ull << page)) touched = 1;
+    }
+    if (!touched) return; //no compiled code anywhere near, nothing to do
+
+    int first = address - JIT_MAX_BLOCK_BYTES + 1; //earliest start of a block that could reach the written bytes
+    if (first < 0) first = 0;
+    for (int start = first & ~1; start <= last; start += 2) {
+        jitBlock *block = &jit->blocks[start >> 1];
+        if (block->compiled && block->end > address) {
+            memset(block, 0, sizeof(*block)); //code stays in the buffer until the next flush
+        }
+    }
+}
+
+void jitStepInstructions(chip8 *c8, int count) {
+    struct chip8Jit *jit = c8->jit;
+    if (jit == NULL || c8->breaks.armed) { //compiled blocks would run straight past a breakpoint
+        stepInstructions(c8, count);
+        return;
+    }
+    if (jit->bitShiftQuirk != c8->bitShiftQuirk) { //blocks were compiled for the other shift behaviour
+        jitFlush(c8);
+        jit->bitShiftQuirk = c8->bitShiftQuirk;
+    }
+    while (count > 0) {
+        if (c8->keyWait) { //FX0A stopped the machine, same as the interpreter
+            stepInstructions(c8, count);
+            return;
+        }
+        uint16_t pc = c8->regs.PC;
+        if ((pc & 1) || pc > 0xFFE) { //only even addresses inside memory are compiled
+            stepInstructions(c8, 1);
+            count--;
+            continue;
+        }
+        jitBlock *block = &jit->blocks[pc >> 1];
+        if (!block->compiled) compileBlock(c8, jit, pc);
+        if (block->length == 0 || block->length > count) { //interpreter instruction, or block would overshoot count
+            stepInstructions(c8, 1);
+            count--;
+            continue;
+        }
+        int ran = block->code(c8);
+        if (ran == 0) { //bailed out on its first instruction (stack over/underflow), let the interpreter deal with it
+            stepInstructions(c8, 1);
+            ran = 1;
+        }
+        count -= ran;
+    }
+}
+
+#else //not x86-64, recompiler not available so everything stays on the interpreter
+
+int jitCreate(chip8 *c8) { (void)c8; return -1; }
+void jitDestroy(chip8 *c8) { (void)c8; }
+void jitStepInstructions(chip8 *c8, int count) { stepInstructions(c8, count); }
+void jitInvalidate(chip8 *c8, uint16_t address, int length) { (void)c8; (void)address; (void)length; }
+void jitFlush(chip8 *c8) { (void)c8; }
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CHIP8_JIT_H
+#define CHIP8_JIT_H
+
+#include "chip8.h"
+
+// Optional basic block recompiler, translates straight line runs of chip8 instructions into x86-64 code
+// build with -DCHIP8_JIT and jit.c so the core tells it when memory under compiled code is written
+// anything it can't translate (DXYN, FX0A, FX33, FX55 etc) is run by the normal interpreter
+
+int jitCreate(chip8 *c8); //attach a recompiler to the machine, returns 0 on success, -1 if not supported on this platform (machine keeps using the interpreter)
+void jitDestroy(chip8 *c8);
+void jitStepInstructions(chip8 *c8, int count); //same result as stepInstructions, uses compiled blocks where it can
+void jitInvalidate(chip8 *c8, uint16_t address, int length); //memory was written, drop blocks covering those bytes
+void jitFlush(chip8 *c8); //drop every compiled block
+
+#endif
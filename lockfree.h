@@ -0,0 +1,92 @@
+#ifndef LOCKFREE_H
+#define LOCKFREE_H
+
+#include <stdatomic.h> //C11 atomics
+#include <stddef.h> //for size_t
+#include <string.h> //for memcpy
+
+// Lock free handoff between exactly two threads, used to pass things between the emulation thread and the SDL thread
+// neither side ever waits on the other, so a slow renderer can't stall the core and a busy core can't stall the renderer
+
+// Single producer single consumer queue of fixed size items, capacity must be a power of two
+// head and tail only ever count up, the slot is the count masked by capacity - 1
+typedef struct {
+    _Atomic unsigned head; //next item to pop, only written by the consumer
+    _Atomic unsigned tail; //next free slot, only written by the producer
+    unsigned capacity;
+    size_t itemSize;
+    unsigned char *items; //capacity * itemSize bytes owned by the caller
+} spscQueue;
+
+static inline void spscInit(spscQueue *q, void *items, unsigned capacity, size_t itemSize) {
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->capacity = capacity;
+    q->itemSize = itemSize;
+    q->items = items;
+}
+
+static inline int spscPush(spscQueue *q, const void *item) { //producer only, returns 0 on success, -1 if full
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire); //slot is free once the consumer has moved past it
+    if (tail - head == q->capacity) {
+        return -1;
+    }
+    memcpy(q->items + (tail & (q->capacity - 1)) * q->itemSize, item, q->itemSize);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release); //item is written before the consumer can see it
+    return 0;
+}
+
+static inline int spscPop(spscQueue *q, void *item) { //consumer only, returns 0 on success, -1 if empty
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head == tail) {
+        return -1;
+    }
+    memcpy(item, q->items + (head & (q->capacity - 1)) * q->itemSize, q->itemSize);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release); //done reading, producer can reuse the slot
+    return 0;
+}
+
+// Triple buffer, the writer always has a buffer to fill and the reader always has a complete one to look at
+// the third buffer sits in the middle and the two sides swap with it, so the reader gets the newest finished
+// buffer and any the reader never looked at are just overwritten
+#define TRIPLE_FRESH 4 //set in middle when the writer has published since the reader last took it
+
+typedef struct {
+    _Atomic int middle; //index of the spare buffer, plus TRIPLE_FRESH if it holds something new
+    int back; //writer's buffer, only touched by the writer
+    int front; //reader's buffer, only touched by the reader
+    size_t size;
+    unsigned char *buffers; //3 * size bytes owned by the caller
+} tripleBuffer;
+
+static inline void tripleInit(tripleBuffer *tb, void *buffers, size_t size) {
+    tb->back = 0;
+    atomic_init(&tb->middle, 1);
+    tb->front = 2;
+    tb->size = size;
+    tb->buffers = buffers;
+}
+
+static inline void *tripleWriteBuffer(tripleBuffer *tb) { //writer, buffer to fill in before triplePublish
+    return tb->buffers + tb->back * tb->size;
+}
+
+static inline void triplePublish(tripleBuffer *tb) { //writer, hand the filled buffer over and take the spare one
+    int old = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLE_FRESH, memory_order_acq_rel);
+    tb->back = old & 3;
+}
+
+static inline void *tripleReadBuffer(tripleBuffer *tb, int *fresh) { //reader, newest published buffer, fresh is set to 1 if it's different to last time
+    int isFresh = 0;
+    if (atomic_load_explicit(&tb->middle, memory_order_relaxed) & TRIPLE_FRESH) {
+        int old = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = old & 3;
+        isFresh = 1;
+    }
+    if (fresh) *fresh = isFresh;
+    return tb->buffers + tb->front * tb->size;
+}
+
+#endif
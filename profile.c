@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+#define REPORT_TOP 32 //hot addresses listed in the report
+#define MAX_WAIT_LOOP 8 //instructions, longer loops are doing real work
+
+typedef struct {
+    uint64_t count;
+    int index;
+} countEntry;
+
+static int byCountDescending(const void *a, const void *b) {
+    const countEntry *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->index - y->index; //ties in address order so reports are stable
+}
+
+static int sortCounts(const uint64_t *counts, int n, countEntry *out) { //non zero counts, biggest first, returns how many
+    int used = 0;
+    for (int i = 0; i < n; i++) {
+        if (counts[i]) {
+            out[used].count = counts[i];
+            out[used].index = i;
+            used++;
+        }
+    }
+    qsort(out, used, sizeof(countEntry), byCountDescending);
+    return used;
+}
+
+static uint16_t opcodeAt(const chip8 *c8, int address) {
+    return (c8->mainMemory[address & 0xFFF] << 8) | c8->mainMemory[(address + 1) & 0xFFF];
+}
+
+int profileStart(chip8 *c8) {
+    if (c8->profile) return 0; //already profiling
+    struct chip8Profile *p = calloc(1, sizeof(struct chip8Profile));
+    if (p == NULL) {
+        return -1;
+    }
+    p->nodes[0].function = c8->regs.PC & 0xFFF; //root is wherever the machine is now, normally the rom start
+    p->nodeCount = 1;
+    c8->profile = p;
+    return 0;
+}
+
+void profileCall(struct chip8Profile *p, uint16_t site, uint16_t target) {
+    p->callCount[site]++;
+    if (p->depth == PROFILE_MAX_DEPTH) {
+        return; //guest stack overflows here too, the core won't make the call
+    }
+    p->callSites[p->depth] = site;
+    p->callerNodes[p->depth] = p->current;
+    p->depth++;
+
+    int child = p->nodes[p->current].firstChild;
+    while (child && p->nodes[child].function != target) {
+        child = p->nodes[child].nextSibling;
+    }
+    if (child == 0 && p->nodeCount < PROFILE_MAX_NODES) { //first time this stack has been seen
+        child = p->nodeCount++;
+        p->nodes[child].function = target;
+        p->nodes[child].parent = p->current;
+        p->nodes[child].nextSibling = p->nodes[p->current].firstChild;
+        p->nodes[p->current].firstChild = child;
+    }
+    if (child) p->current = child; //out of nodes, keep counting in the caller
+}
+
+void profileReturn(struct chip8Profile *p, uint16_t site) {
+    p->returnCount[site]++;
+    if (p->depth == 0) {
+        return; //underflow, the core prints it
+    }
+    p->depth--;
+    p->returnedTo[p->callSites[p->depth]]++;
+    p->current = p->callerNodes[p->depth];
+}
+
+static void writeWaitLoops(FILE *f, const chip8 *c8, const struct chip8Profile *p) {
+    int found = 0;
+    fprintf(f, "\nBusy wait loops:\n");
+    for (int end = 0; end < CHIP8_MEMORY_SIZE; end++) {
+        if (!p->jumpBack[end]) continue;
+        int start = opcodeAt(c8, end) & 0xFFF;
+        if (end - start > 2 * (MAX_WAIT_LOOP - 1)) continue;
+        int pollsTimer = 0, pollsKeys = 0, other = 0;
+        uint64_t cycles = 0;
+        for (int a = start; a <= end; a += 2) {
+            cycles += p->pcCount[a];
+            uint16_t opcode = opcodeAt(c8, a);
+            if ((opcode & 0xF0FF) == 0xF007) {
+                pollsTimer = 1;
+            } else if ((opcode & 0xF0FF) == 0xE09E || (opcode & 0xF0FF) == 0xE0A1) {
+                pollsKeys = 1;
+            } else {
+                switch (opcode >> 12) {
+                    case 0x1: case 0x3: case 0x4: case 0x5: case 0x6: case 0x9: break; //jumps, skips and loads don't make progress on their own
+                    default: other = 1; break;
+                }
+            }
+        }
+        if (other) continue; //does real work
+        const char *kind = pollsTimer ? "delay timer poll (FX07)" : pollsKeys ? "key poll (EX9E/EXA1)" : "spin (jump to itself)";
+        fprintf(f, "  %03X-%03X  %-24s %12llu  %5.1f%%\n", start, end, kind, (unsigned long long)cycles, 100.0 * cycles / p->total);
+        found++;
+    }
+    if (!found) fprintf(f, "  none\n");
+}
+
+static void writeReport(FILE *f, const chip8 *c8, const struct chip8Profile *p) {
+    countEntry *entries = malloc(CHIP8_MEMORY_SIZE * sizeof(countEntry));
+    if (entries == NULL) return;
+    double total = p->total ? (double)p->total : 1.0;
+
+    fprintf(f, "Profile: %llu instructions\n", (unsigned long long)p->total);
+
+    fprintf(f, "\nHot addresses:\n  addr  opcode  kind  %12s  %6s\n", "count", "share");
+    int n = sortCounts(p->pcCount, CHIP8_MEMORY_SIZE, entries);
+    for (int i = 0; i < n && i < REPORT_TOP; i++) {
+        uint16_t opcode = opcodeAt(c8, entries[i].index);
+        fprintf(f, "  %03X   %04X    %s  %12llu  %5.1f%%\n", entries[i].index, opcode, opcodeClassName(opcodeClass(opcode)), (unsigned long long)entries[i].count, 100.0 * entries[i].count / total);
+    }
+
+    fprintf(f, "\nInstruction kinds:\n");
+    n = sortCounts(p->classCount, CHIP8_OPCODE_CLASSES, entries);
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "  %s  %12llu  %5.1f%%\n", opcodeClassName(entries[i].index), (unsigned long long)entries[i].count, 100.0 * entries[i].count / total);
+    }
+
+    fprintf(f, "\nCall sites:\n  site  target  %10s  %10s\n", "calls", "returns");
+    n = sortCounts(p->callCount, CHIP8_MEMORY_SIZE, entries);
+    for (int i = 0; i < n; i++) {
+        int site = entries[i].index;
+        fprintf(f, "  %03X   %03X     %10llu  %10llu\n", site, opcodeAt(c8, site) & 0xFFF, (unsigned long long)entries[i].count, (unsigned long long)p->returnedTo[site]);
+    }
+
+    fprintf(f, "\nReturns:\n  addr  %10s\n", "count");
+    n = sortCounts(p->returnCount, CHIP8_MEMORY_SIZE, entries);
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "  %03X   %10llu\n", entries[i].index, (unsigned long long)entries[i].count);
+    }
+
+    writeWaitLoops(f, c8, p);
+    free(entries);
+}
+
+static void writeCollapsed(FILE *f, const struct chip8Profile *p) { //one line per call stack: main;sub_2A0;sub_31C count
+    for (int i = 0; i < p->nodeCount; i++) {
+        if (!p->nodes[i].self) continue;
+        int path[PROFILE_MAX_DEPTH + 1], depth = 0;
+        for (int n = i; n != 0 && depth < PROFILE_MAX_DEPTH; n = p->nodes[n].parent) {
+            path[depth++] = n;
+        }
+        fprintf(f, "main");
+        while (depth > 0) {
+            fprintf(f, ";sub_%03X", p->nodes[path[--depth]].function);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)p->nodes[i].self);
+    }
+}
+
+void profileStop(chip8 *c8, const char *reportPath, const char *collapsedPath) {
+    struct chip8Profile *p = c8->profile;
+    if (p == NULL) return;
+    c8->profile = NULL;
+    if (reportPath) {
+        FILE *f = fopen(reportPath, "w");
+        if (f) {
+            writeReport(f, c8, p);
+            fclose(f);
+        } else {
+            fprintf(stderr, "Failed to create %s\n", reportPath);
+        }
+    }
+    if (collapsedPath) {
+        FILE *f = fopen(collapsedPath, "w");
+        if (f) {
+            writeCollapsed(f, p);
+            fclose(f);
+        } else {
+            fprintf(stderr, "Failed to create %s\n", collapsedPath);
+        }
+    }
+    free(p);
+}
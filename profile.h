@@ -0,0 +1,66 @@
+#ifndef CHIP8_PROFILE_H
+#define CHIP8_PROFILE_H
+
+#include <stdint.h>
+#include "chip8.h"
+
+// Optional guest profiler, build the core with -DCHIP8_PROFILE and profile.c to get it
+// like the trace, without CHIP8_PROFILE none of it is compiled into the core.
+// Counts every instruction a profiled machine runs by address and by kind, counts calls per call site and
+// the returns that came back to them, and keeps a call tree so time can be shown per call stack.
+// profileStop writes a sorted text report (which also flags busy wait loops polling the delay timer or keys)
+// and a collapsed stack file that flamegraph.pl, speedscope etc read directly.
+
+#define PROFILE_MAX_NODES 4096 //distinct call stacks kept, deeper ones are counted in their caller
+#define PROFILE_MAX_DEPTH 16 //same as the chip8 stack
+
+typedef struct {
+    uint16_t function; //address this call stack ends in, the rom start for the root
+    uint16_t parent;
+    uint16_t firstChild; //0 is none, the root is never anyone's child
+    uint16_t nextSibling;
+    uint64_t self; //instructions run with exactly this call stack
+} profileNode;
+
+struct chip8Profile {
+    uint64_t total;
+    uint64_t pcCount[CHIP8_MEMORY_SIZE]; //instructions run at each address
+    uint64_t classCount[CHIP8_OPCODE_CLASSES];
+    uint64_t callCount[CHIP8_MEMORY_SIZE]; //by address of the 2NNN
+    uint64_t returnedTo[CHIP8_MEMORY_SIZE]; //returns that came back to the 2NNN at this address
+    uint64_t returnCount[CHIP8_MEMORY_SIZE]; //by address of the 00EE
+    uint64_t jumpBack[CHIP8_MEMORY_SIZE]; //backward 1NNN jumps by address, where loops close
+    profileNode nodes[PROFILE_MAX_NODES];
+    int nodeCount;
+    int current; //node for the call stack right now
+    int depth;
+    uint16_t callSites[PROFILE_MAX_DEPTH]; //shadow of the guest stack, to match returns to calls
+    uint16_t callerNodes[PROFILE_MAX_DEPTH];
+};
+
+int profileStart(chip8 *c8); //returns 0 on success, -1 if out of memory
+void profileStop(chip8 *c8, const char *reportPath, const char *collapsedPath); //write the report and collapsed stacks and stop profiling, either path can be NULL
+
+void profileCall(struct chip8Profile *p, uint16_t site, uint16_t target);
+void profileReturn(struct chip8Profile *p, uint16_t site);
+
+static inline void profileInstruction(struct chip8Profile *p, uint16_t pc, uint16_t opcode) { //called by the core before each instruction runs
+    pc &= 0xFFF;
+    p->total++;
+    p->pcCount[pc]++;
+    p->classCount[opcodeClass(opcode)]++;
+    p->nodes[p->current].self++;
+    switch (opcode >> 12) {
+        case 0x0:
+            if (opcode == 0x00EE) profileReturn(p, pc);
+            break;
+        case 0x1:
+            if ((opcode & 0xFFF) <= pc) p->jumpBack[pc]++;
+            break;
+        case 0x2:
+            profileCall(p, pc, opcode & 0xFFF);
+            break;
+    }
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include "record.h"
+
+#define REPLAY_CHUNK (1 << 30) //stepInstructions takes an int
+
+uint32_t displayHash(const chip8 *c8) {
+    uint32_t hash = 0x811C9DC5; //FNV offset basis
+    hash ^= c8->hires;
+    hash *= 0x01000193; //FNV prime
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        for (int y = 0; y < CHIP8_HIRES_HEIGHT; y++) {
+            for (int w = 0; w < CHIP8_ROW_WORDS; w++) {
+                for (int b = 0; b < 8; b++) {
+                    hash ^= (uint8_t)(c8->display[plane][y][w] >> (56 - 8 * b)); //byte order fixed so hashes match across platforms
+                    hash *= 0x01000193;
+                }
+            }
+        }
+    }
+    return hash;
+}
+
+static int quirkBits(const chip8 *c8) {
+    return (c8->loadStoreRegQuirk ? 1 : 0) | (c8->spriteWrapClipQuirk ? 2 : 0) | (c8->bitShiftQuirk ? 4 : 0);
+}
+
+static void writeEvent(inputRecorder *r, uint8_t type) { //instruction count since the last event then the type
+    uint64_t n = r->pending;
+    do {
+        uint8_t byte = n & 0x7F;
+        n >>= 7;
+        fputc(n ? byte | 0x80 : byte, r->file);
+    } while (n);
+    fputc(type, r->file);
+    r->pending = 0;
+    r->events++;
+}
+
+int recordStart(inputRecorder *r, const chip8 *c8, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    r->file = f;
+    r->pending = 0;
+    r->events = 0;
+    r->lastHash = displayHash(c8);
+    fwrite(RECORD_MAGIC, 1, 4, f);
+    fputc(RECORD_VERSION, f);
+    saveState(c8, r->state);
+    fwrite(r->state, 1, CHIP8_STATE_SIZE, f);
+    return 0;
+}
+
+void recordStop(inputRecorder *r) {
+    if (r->file == NULL) return;
+    writeEvent(r, RECORD_END);
+    fclose(r->file);
+    r->file = NULL;
+}
+
+void recordKey(inputRecorder *r, int key, int pressed) {
+    if (r->file == NULL || key < 0 || key > 0xF) return;
+    writeEvent(r, (pressed ? RECORD_KEY_DOWN : RECORD_KEY_UP) | key);
+}
+
+void recordTick(inputRecorder *r, const chip8 *c8) {
+    if (r->file == NULL) return;
+    uint32_t hash = displayHash(c8);
+    if (hash == r->lastHash) {
+        writeEvent(r, RECORD_TICK);
+        return;
+    }
+    writeEvent(r, RECORD_TICK_FRAME);
+    uint8_t bytes[4] = { hash, hash >> 8, hash >> 16, hash >> 24 };
+    fwrite(bytes, 1, 4, r->file);
+    r->lastHash = hash;
+}
+
+void recordQuirks(inputRecorder *r, const chip8 *c8) {
+    if (r->file == NULL) return;
+    writeEvent(r, RECORD_QUIRKS);
+    fputc(quirkBits(c8), r->file);
+}
+
+void recordState(inputRecorder *r, const chip8 *c8) {
+    if (r->file == NULL) return;
+    writeEvent(r, RECORD_STATE);
+    saveState(c8, r->state);
+    fwrite(r->state, 1, CHIP8_STATE_SIZE, r->file);
+    r->lastHash = displayHash(c8);
+}
+
+static void replayRun(chip8 *c8, uint64_t count, replayResult *result) {
+    result->instructions += count;
+    while (count > 0) {
+        int n = count > REPLAY_CHUNK ? REPLAY_CHUNK : (int)count;
+        stepInstructions(c8, n);
+        count -= n;
+    }
+}
+
+int replayRecording(chip8 *c8, const uint8_t *data, size_t size, replayResult *result, replayFrameFunc onFrame, void *user) {
+    memset(result, 0, sizeof(*result));
+    if (size < 5 + CHIP8_STATE_SIZE || memcmp(data, RECORD_MAGIC, 4) != 0 || data[4] != RECORD_VERSION) {
+        return -1;
+    }
+    loadState(c8, data + 5);
+    uint32_t expected = displayHash(c8);
+    size_t at = 5 + CHIP8_STATE_SIZE;
+    while (at < size) {
+        uint64_t count = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            if (at >= size || shift > 63) return -1;
+            byte = data[at++];
+            count |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (at >= size) return -1;
+        uint8_t type = data[at++];
+        replayRun(c8, count, result);
+
+        if (type < RECORD_TICK) {
+            setKey(c8, type & 0xF, type >= RECORD_KEY_DOWN);
+        } else if (type == RECORD_TICK || type == RECORD_TICK_FRAME) {
+            if (type == RECORD_TICK_FRAME) {
+                if (at + 4 > size) return -1;
+                expected = data[at] | data[at + 1] << 8 | data[at + 2] << 16 | (uint32_t)data[at + 3] << 24;
+                at += 4;
+            }
+            tickTimers(c8);
+            if (displayHash(c8) != expected) {
+                if (result->mismatches == 0) result->firstMismatch = result->frames;
+                result->mismatches++;
+            }
+            if (onFrame) onFrame(user, c8, result->frames);
+            result->frames++;
+        } else if (type == RECORD_QUIRKS) {
+            if (at >= size) return -1;
+            uint8_t bits = data[at++];
+            c8->loadStoreRegQuirk = (bits & 1) != 0;
+            c8->spriteWrapClipQuirk = (bits & 2) != 0;
+            c8->bitShiftQuirk = (bits & 4) != 0;
+            selectInterpreter(c8);
+        } else if (type == RECORD_STATE) {
+            if (at + CHIP8_STATE_SIZE > size) return -1;
+            loadState(c8, data + at);
+            at += CHIP8_STATE_SIZE;
+            expected = displayHash(c8);
+        } else if (type == RECORD_END) {
+            return 0;
+        } else {
+            return -1; //newer event type than this knows about
+        }
+    }
+    return -1; //no end event, the recording was cut short (e.g. the emulator crashed), what ran is still in result
+}
@@ -0,0 +1,65 @@
+#ifndef CHIP8_RECORD_H
+#define CHIP8_RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "chip8.h"
+#include "snapshot.h" //recordings start from a full machine state
+
+// Input recording and replay, everything from outside the machine (key presses, timer ticks, quirk changes, loaded states)
+// stamped with how many instructions ran before it, so a replay puts each one at exactly the same instruction and
+// gets exactly the same frames. The core itself is deterministic (the random numbers are in the machine state) so
+// nothing else is needed.
+// File layout: magic, version byte, the machine state when recording started, then events. Each event is
+// the instructions since the last event as a LEB128 varint followed by one type byte and maybe some data:
+//   00-0F key up, 10-1F key down (low 4 bits are the key)
+//   20    timer tick, display hash is the same as the last one recorded
+//   21    timer tick, followed by the new 32 bit display hash (little endian), only written when the display changed
+//   22    quirk flags changed, followed by one byte: 1 loadStoreRegQuirk, 2 spriteWrapClipQuirk, 4 bitShiftQuirk
+//   23    whole machine replaced (rom or snapshot loaded, rewound), followed by CHIP8_STATE_SIZE bytes of state
+//   24    end of recording, the instruction count is the ones run after the last event
+// A still screen costs 2 bytes a frame, so a recording is a few hundred bytes per second of play.
+
+#define RECORD_MAGIC "C8RC"
+#define RECORD_VERSION 2 //states in recordings are snapshot states, so this goes up with CHIP8_SNAPSHOT_VERSION
+#define RECORD_KEY_UP 0x00
+#define RECORD_KEY_DOWN 0x10
+#define RECORD_TICK 0x20
+#define RECORD_TICK_FRAME 0x21
+#define RECORD_QUIRKS 0x22
+#define RECORD_STATE 0x23
+#define RECORD_END 0x24
+
+typedef struct {
+    FILE *file; //NULL when not recording
+    uint64_t pending; //instructions run since the last event
+    uint64_t events;
+    uint32_t lastHash; //display hash the last tick recorded
+    uint8_t state[CHIP8_STATE_SIZE]; //scratch for state events
+} inputRecorder;
+
+uint32_t displayHash(const chip8 *c8); //32 bit FNV-1a of the display mode and every plane
+
+int recordStart(inputRecorder *r, const chip8 *c8, const char *path); //returns 0 on success, -1 if the file can't be created
+void recordStop(inputRecorder *r); //write the end event and close the file, nothing if not recording
+static inline void recordRan(inputRecorder *r, int count) { //call with every count given to stepInstructions, 1 for each fetchDecodeExecute
+    r->pending += count;
+}
+void recordKey(inputRecorder *r, int key, int pressed); //call with every setKey
+void recordTick(inputRecorder *r, const chip8 *c8); //call after every tickTimers
+void recordQuirks(inputRecorder *r, const chip8 *c8); //call after the quirk flags change
+void recordState(inputRecorder *r, const chip8 *c8); //call after the machine is replaced some other way (rom or snapshot loaded, rewind)
+
+// Replay, runs a whole recording from memory as fast as possible
+typedef struct {
+    uint64_t instructions;
+    uint64_t frames; //timer ticks
+    uint64_t mismatches; //frames whose display hash wasn't the recorded one
+    uint64_t firstMismatch; //frame number of the first, if there were any
+} replayResult;
+
+typedef void (*replayFrameFunc)(void *user, const chip8 *c8, uint64_t frame); //called after every timer tick
+
+int replayRecording(chip8 *c8, const uint8_t *data, size_t size, replayResult *result, replayFrameFunc onFrame, void *user); //returns 0 on success, -1 if it's not a recording or it's cut short (result has what ran)
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include "render.h"
+
+int createDisplayRenderer(displayRenderer *dr, SDL_Renderer *renderer) {
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0"); //nearest neighbour so pixels stay square when scaled
+    dr->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, CHIP8_HIRES_WIDTH, CHIP8_HIRES_HEIGHT); //big enough for hires, lores uses the top left corner
+    if (!dr->texture) {
+        printf("Failed to create display texture: %s\n", SDL_GetError());
+        return -1;
+    }
+    return 0;
+}
+
+void drawDisplay(const uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS], int hires, SDL_Renderer *renderer, displayRenderer *dr){
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); //black background for the overlay
+    SDL_RenderClear(renderer); //turn screen to black
+
+    int width = hires ? CHIP8_HIRES_WIDTH : CHIP8_DISPLAY_WIDTH;
+    int height = hires ? CHIP8_HIRES_HEIGHT : CHIP8_DISPLAY_HEIGHT;
+    const uint32_t palette[4] = { dr->offColour, dr->onColour, dr->plane2Colour, dr->bothColour }; //indexed by a bit per plane
+    SDL_Rect src = { 0, 0, width, height };
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(dr->texture, &src, &pixels, &pitch) == 0) { //write straight into the texture, one uint32 per chip8 pixel
+        for (int y = 0; y < height; y++) {
+            uint32_t *row = (uint32_t *)((uint8_t *)pixels + y * pitch);
+            for (int w = 0; w < width / 64; w++) {
+                uint64_t first = display[0][y][w]; //64 pixels of each plane, leftmost is the top bit
+                uint64_t second = display[1][y][w];
+                for (int x = 0; x < 64; x++) {
+                    row[w * 64 + x] = palette[((first >> (63 - x)) & 1) | ((second >> (63 - x)) & 1) << 1];
+                }
+            }
+        }
+        SDL_UnlockTexture(dr->texture);
+    }
+    SDL_Rect dst = { 0, 0, CHIP8_DISPLAY_WIDTH * dr->scale, CHIP8_DISPLAY_HEIGHT * dr->scale }; //same size on screen in either mode, hires pixels are half the size
+    SDL_RenderCopy(renderer, dr->texture, &src, &dst); //one copy, GPU does the scaling
+}
+
+int createTextRenderer(textRenderer *tr, SDL_Renderer *renderer, TTF_Font *font) {
+    int height = TTF_FontHeight(font);
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *glyphSurfaces[GLYPH_COUNT];
+
+    //lay glyphs out in rows ATLAS_WIDTH wide
+    int penX = 0, penY = 0;
+    for (int c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+        int g = c - FIRST_GLYPH;
+        int minX, maxX, minY, maxY;
+        TTF_GlyphMetrics(font, c, &minX, &maxX, &minY, &maxY, &tr->advance[g]);
+        glyphSurfaces[g] = TTF_RenderGlyph_Blended(font, c, white);
+        int w = glyphSurfaces[g] ? glyphSurfaces[g]->w : 0;
+        if (penX + w > ATLAS_WIDTH) {
+            penX = 0;
+            penY += height;
+        }
+        tr->glyphs[g] = (SDL_Rect){ penX, penY, w, height };
+        penX += w + 1; //1 pixel gap so scaling never bleeds into the next glyph
+    }
+    tr->atlasWidth = ATLAS_WIDTH;
+    tr->atlasHeight = penY + height;
+
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, tr->atlasWidth, tr->atlasHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!atlas) {
+        printf("Failed to create glyph atlas: %s\n", SDL_GetError());
+        return -1;
+    }
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        if (glyphSurfaces[g]) {
+            SDL_SetSurfaceBlendMode(glyphSurfaces[g], SDL_BLENDMODE_NONE); //copy alpha as is
+            SDL_Rect dst = tr->glyphs[g];
+            SDL_BlitSurface(glyphSurfaces[g], NULL, atlas, &dst);
+            SDL_FreeSurface(glyphSurfaces[g]);
+        }
+    }
+    tr->atlas = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+    if (!tr->atlas) {
+        printf("Failed to create glyph texture: %s\n", SDL_GetError());
+        return -1;
+    }
+    SDL_SetTextureBlendMode(tr->atlas, SDL_BLENDMODE_BLEND);
+    tr->slotCount = 0;
+    tr->batchQuads = 0;
+    return 0;
+}
+
+static void layoutText(textRenderer *tr, textSlot *slot) { //build quads for the slots string, only when it changed
+    float penX = slot->x;
+    slot->quads = 0;
+    for (const char *p = slot->text; *p; p++) {
+        int c = (unsigned char)*p;
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+        int g = c - FIRST_GLYPH;
+        SDL_Rect src = tr->glyphs[g];
+        if (src.w > 0) {
+            float u0 = (float)src.x / tr->atlasWidth, v0 = (float)src.y / tr->atlasHeight;
+            float u1 = (float)(src.x + src.w) / tr->atlasWidth, v1 = (float)(src.y + src.h) / tr->atlasHeight;
+            SDL_Vertex *v = &slot->vertices[slot->quads * 4];
+            v[0] = (SDL_Vertex){ { penX, slot->y }, slot->color, { u0, v0 } };
+            v[1] = (SDL_Vertex){ { penX + src.w, slot->y }, slot->color, { u1, v0 } };
+            v[2] = (SDL_Vertex){ { penX + src.w, slot->y + src.h }, slot->color, { u1, v1 } };
+            v[3] = (SDL_Vertex){ { penX, slot->y + src.h }, slot->color, { u0, v1 } };
+            slot->quads++;
+        }
+        penX += tr->advance[g];
+    }
+}
+
+void drawText(textRenderer *tr, int x, int y, const char *text, SDL_Color color) { //queue text to be drawn at the next flushText
+    textSlot *slot = NULL;
+    for (int i = 0; i < tr->slotCount; i++) { //text is found by where it's drawn, same place each frame
+        if (tr->slots[i].x == x && tr->slots[i].y == y) {
+            slot = &tr->slots[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        if (tr->slotCount == MAX_TEXT_SLOTS) return; //out of slots, won't happen with the current overlay
+        slot = &tr->slots[tr->slotCount++];
+        slot->x = x;
+        slot->y = y;
+        slot->text[0] = '\0';
+        slot->quads = -1; //force layout
+    }
+    if (slot->quads < 0 || strncmp(slot->text, text, MAX_TEXT - 1) != 0 || memcmp(&slot->color, &color, sizeof(color)) != 0) { //only lay out again if it changed
+        snprintf(slot->text, MAX_TEXT, "%s", text);
+        slot->color = color;
+        layoutText(tr, slot);
+    }
+    slot->used = 1; //drawing the same place twice in one frame only keeps the last string
+}
+
+void flushText(textRenderer *tr, SDL_Renderer *renderer) { //draw every piece of text queued this frame in one call
+    tr->batchQuads = 0;
+    for (int i = 0; i < tr->slotCount; i++) {
+        textSlot *slot = &tr->slots[i];
+        if (!slot->used) continue; //not drawn this frame (e.g. PAUSED when running)
+        slot->used = 0;
+        memcpy(&tr->batchVertices[tr->batchQuads * 4], slot->vertices, slot->quads * 4 * sizeof(SDL_Vertex));
+        for (int q = 0; q < slot->quads; q++) {
+            int base = (tr->batchQuads + q) * 4;
+            int *idx = &tr->batchIndices[(tr->batchQuads + q) * 6];
+            idx[0] = base; idx[1] = base + 1; idx[2] = base + 2; //two triangles per quad
+            idx[3] = base; idx[4] = base + 2; idx[5] = base + 3;
+        }
+        tr->batchQuads += slot->quads;
+    }
+    if (tr->batchQuads > 0) {
+        SDL_RenderGeometry(renderer, tr->atlas, tr->batchVertices, tr->batchQuads * 4, tr->batchIndices, tr->batchQuads * 6);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef CHIP8_RENDER_H
+#define CHIP8_RENDER_H
+
+#include <stdint.h> //for unsignted ints
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "chip8.h"
+
+// Drawing for the SDL frontend, the chip8 display as one scaled texture and overlay text from a glyph atlas
+// kept out of Chip8Emu.c so the benchmark can draw into an offscreen renderer with the same code
+
+typedef struct {
+    SDL_Texture *texture; //128x64 streaming texture, display is copied in each frame and the GPU scales it up
+    int scale; //window pixels per chip8 pixel, 10 by default
+    uint32_t onColour; //ARGB8888 colour for lit pixels
+    uint32_t offColour; //ARGB8888 colour for unlit pixels
+    uint32_t plane2Colour; //pixels lit only in the second XO-CHIP plane
+    uint32_t bothColour; //pixels lit in both planes
+} displayRenderer;
+
+int createDisplayRenderer(displayRenderer *dr, SDL_Renderer *renderer);
+void drawDisplay(const uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS], int hires, SDL_Renderer *renderer, displayRenderer *dr); //clear and draw the display planes at the top left, scaled, lores or hires fill the same area
+
+// Text is drawn from a glyph atlas made once at startup instead of rendering and uploading a new texture for every string every frame.
+// Each piece of text keeps its quads from last frame and only lays them out again when the string changes,
+// all the quads for a frame go to the GPU in one SDL_RenderGeometry call in flushText.
+#define FIRST_GLYPH 32 //space
+#define LAST_GLYPH 126 //~
+#define GLYPH_COUNT (LAST_GLYPH - FIRST_GLYPH + 1)
+#define ATLAS_WIDTH 512
+#define MAX_TEXT 64 //longest string a slot holds
+#define MAX_TEXT_SLOTS 128 //different places text is drawn
+
+typedef struct {
+    char text[MAX_TEXT];
+    int x, y;
+    SDL_Color color;
+    int used; //drawn this frame
+    int quads;
+    SDL_Vertex vertices[MAX_TEXT * 4];
+} textSlot;
+
+typedef struct {
+    SDL_Texture *atlas; //white glyphs, coloured by vertex colour
+    SDL_Rect glyphs[GLYPH_COUNT]; //where each character is in the atlas
+    int advance[GLYPH_COUNT]; //how far to move right after each character
+    int atlasWidth, atlasHeight;
+    textSlot slots[MAX_TEXT_SLOTS];
+    int slotCount;
+    SDL_Vertex batchVertices[MAX_TEXT_SLOTS * MAX_TEXT * 4]; //everything drawn this frame
+    int batchIndices[MAX_TEXT_SLOTS * MAX_TEXT * 6];
+    int batchQuads;
+} textRenderer;
+
+int createTextRenderer(textRenderer *tr, SDL_Renderer *renderer, TTF_Font *font); //build the atlas, font can be closed afterwards
+void drawText(textRenderer *tr, int x, int y, const char *text, SDL_Color color); //queue text to be drawn at the next flushText
+void flushText(textRenderer *tr, SDL_Renderer *renderer); //draw every piece of text queued this frame in one call
+
+#endif
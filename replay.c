@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h> //for timing the replay
+#include "record.h"
+#ifdef CHIP8_PROFILE
+#include "profile.h" //optional guest profiler, -P
+#endif
+
+// Headless replay of a recording made with F7 or --record in the emulator, no window and no frame delay
+// runs the exact instructions, key presses and timer ticks of the session and checks every frame's display hash
+// against the one recorded, so a slow or broken session can be run again under a profiler or kept as a regression test.
+//   -o frames.txt  write "frame hash" for every frame
+//   -d final.pbm   write the display at the end
+//   -P             guest profile into profile.txt and profile.folded, when built with -DCHIP8_PROFILE profile.c
+// exits 0 if the recording was complete and every frame matched, 1 otherwise
+// gcc -O2 replay.c record.c snapshot.c chip8.c -o replay
+
+static void writeFrameHash(void *user, const chip8 *c8, uint64_t frame) {
+    fprintf(user, "%llu %08x\n", (unsigned long long)frame, displayHash(c8));
+}
+
+static uint8_t *readFile(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = length > 0 ? malloc(length) : NULL;
+    if (data == NULL || fread(data, 1, length, f) != (size_t)length) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = length;
+    return data;
+}
+
+int main(int argc, char *argv[]) {
+    const char *recordingPath = NULL, *framesPath = NULL, *displayPath = NULL;
+    int useProfile = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            framesPath = argv[++i];
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            displayPath = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0) {
+#ifdef CHIP8_PROFILE
+            useProfile = 1;
+#else
+            fprintf(stderr, "Built without CHIP8_PROFILE, ignoring -P\n");
+#endif
+        } else if (recordingPath == NULL) {
+            recordingPath = argv[i];
+        }
+    }
+    if (recordingPath == NULL) {
+        fprintf(stderr, "Usage: %s recording.c8r [-o frames.txt] [-d final.pbm] [-P]\n", argv[0]);
+        return 1;
+    }
+    size_t size;
+    uint8_t *data = readFile(recordingPath, &size);
+    if (data == NULL) {
+        fprintf(stderr, "Failed to read %s\n", recordingPath);
+        return 1;
+    }
+    FILE *frames = NULL;
+    if (framesPath) {
+        frames = fopen(framesPath, "w");
+        if (frames == NULL) {
+            fprintf(stderr, "Failed to create %s\n", framesPath);
+            free(data);
+            return 1;
+        }
+    }
+
+    static chip8 machine; //static so the machine isn't on the stack
+    chip8 *c8 = &machine;
+    initialiseSystem(c8); //loadState replaces all of it, this just makes sure the pointers are NULL
+#ifdef CHIP8_PROFILE
+    if (useProfile && profileStart(c8) != 0) {
+        fprintf(stderr, "Failed to start profiler\n");
+    }
+#endif
+    (void)useProfile;
+
+    replayResult result;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status = replayRecording(c8, data, size, &result, frames ? writeFrameHash : NULL, frames);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+#ifdef CHIP8_PROFILE
+    profileStop(c8, "profile.txt", "profile.folded"); //nothing if not profiling
+#endif
+    if (frames) fclose(frames);
+    if (displayPath) {
+        FILE *pbm = fopen(displayPath, "w");
+        if (pbm) { //plain pbm, 1 is a pixel lit in any plane, 128x64 in hires
+            fprintf(pbm, "P1\n%d %d\n", displayWidth(c8), displayHeight(c8));
+            for (int y = 0; y < displayHeight(c8); y++) {
+                for (int x = 0; x < displayWidth(c8); x++) {
+                    fputc(getPixel(c8, x, y) ? '1' : '0', pbm);
+                }
+                fputc('\n', pbm);
+            }
+            fclose(pbm);
+        } else {
+            fprintf(stderr, "Failed to create %s\n", displayPath);
+        }
+    }
+    free(data);
+
+    printf("%llu instructions, %llu frames in %.3fs (%.0f instructions/sec, %.0fx real time at 60fps)\n",
+        (unsigned long long)result.instructions, (unsigned long long)result.frames, seconds,
+        seconds > 0 ? result.instructions / seconds : 0.0, seconds > 0 ? result.frames / 60.0 / seconds : 0.0);
+    if (status != 0) {
+        printf("Recording is not complete or not a recording, stopped after frame %llu\n", (unsigned long long)result.frames);
+    }
+    if (result.mismatches) {
+        printf("%llu frames differ from the recording, first at frame %llu\n", (unsigned long long)result.mismatches, (unsigned long long)result.firstMismatch);
+    } else {
+        printf("All frames match\n");
+    }
+    return status != 0 || result.mismatches ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "romdb.h"
+
+uint64_t romHash(const uint8_t *rom, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL; //FNV offset basis
+    for (size_t i = 0; i < size; i++) {
+        hash ^= rom[i];
+        hash *= 0x100000001B3ULL; //FNV prime
+    }
+    return hash;
+}
+
+static void parseRanges(romEntry *e, char *list) { //200-2F5,300-31F
+    for (char *item = strtok(list, ","); item && e->rangeCount < ROMDB_MAX_RANGES; item = strtok(NULL, ",")) {
+        unsigned start, end;
+        if (sscanf(item, "%x-%x", &start, &end) == 2 && start <= end && end < CHIP8_MEMORY_SIZE) {
+            e->ranges[e->rangeCount].start = start;
+            e->ranges[e->rangeCount].end = end;
+            e->rangeCount++;
+        }
+    }
+}
+
+static void parseIdle(romEntry *e, char *list) { //2A4,31C
+    for (char *item = strtok(list, ","); item && e->idleCount < ROMDB_MAX_IDLE; item = strtok(NULL, ",")) {
+        unsigned address;
+        if (sscanf(item, "%x", &address) == 1 && address < CHIP8_MEMORY_SIZE) {
+            e->idleLoops[e->idleCount++] = address;
+        }
+    }
+}
+
+int romdbLoad(romDatabase *db, const char *path) {
+    memset(db, 0, sizeof(*db));
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char line[2048];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        romEntry e;
+        memset(&e, 0, sizeof(e));
+        unsigned long long hash;
+        char quirks[8], extra[2][1024];
+        extra[0][0] = extra[1][0] = '\0';
+        if (sscanf(line, "%llx %7s %d %63s %1023s %1023s", &hash, quirks, &e.instructionHz, e.name, extra[0], extra[1]) < 4 || e.instructionHz < 1) {
+            fprintf(stderr, "Skipping bad rom database entry on line %d\n", lineNumber);
+            continue;
+        }
+        e.hash = hash;
+        e.loadStoreRegQuirk = strchr(quirks, 'l') != NULL;
+        e.spriteWrapClipQuirk = strchr(quirks, 'c') != NULL;
+        e.bitShiftQuirk = strchr(quirks, 's') != NULL;
+        for (int i = 0; i < 2; i++) {
+            if (strncmp(extra[i], "code=", 5) == 0) parseRanges(&e, extra[i] + 5);
+            if (strncmp(extra[i], "idle=", 5) == 0) parseIdle(&e, extra[i] + 5);
+        }
+        if (romdbAdd(db, &e) == NULL) break;
+    }
+    fclose(f);
+    return 0;
+}
+
+int romdbSave(const romDatabase *db, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f, "# chip8 rom database, one rom per line: hash quirks hz name [code=start-end,...] [idle=address,...]\n");
+    fprintf(f, "# quirks: l (FX55/FX65 leave I), c (clip sprites), s (shifts use VX), - for none\n");
+    for (int i = 0; i < db->count; i++) {
+        const romEntry *e = &db->entries[i];
+        char quirks[4];
+        int n = 0;
+        if (e->loadStoreRegQuirk) quirks[n++] = 'l';
+        if (e->spriteWrapClipQuirk) quirks[n++] = 'c';
+        if (e->bitShiftQuirk) quirks[n++] = 's';
+        if (n == 0) quirks[n++] = '-';
+        quirks[n] = '\0';
+        fprintf(f, "%016llx %-3s %7d %-24s", (unsigned long long)e->hash, quirks, e->instructionHz, e->name);
+        for (int r = 0; r < e->rangeCount; r++) {
+            fprintf(f, "%s%03X-%03X", r == 0 ? " code=" : ",", e->ranges[r].start, e->ranges[r].end);
+        }
+        for (int r = 0; r < e->idleCount; r++) {
+            fprintf(f, "%s%03X", r == 0 ? " idle=" : ",", e->idleLoops[r]);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return 0;
+}
+
+void romdbFree(romDatabase *db) {
+    free(db->entries);
+    memset(db, 0, sizeof(*db));
+}
+
+romEntry *romdbFind(romDatabase *db, uint64_t hash) {
+    for (int i = 0; i < db->count; i++) {
+        if (db->entries[i].hash == hash) return &db->entries[i];
+    }
+    return NULL;
+}
+
+romEntry *romdbAdd(romDatabase *db, const romEntry *entry) {
+    if (db->count == db->capacity) {
+        int capacity = db->capacity ? db->capacity * 2 : 16;
+        romEntry *entries = realloc(db->entries, capacity * sizeof(romEntry));
+        if (entries == NULL) {
+            return NULL;
+        }
+        db->entries = entries;
+        db->capacity = capacity;
+    }
+    db->entries[db->count] = *entry;
+    return &db->entries[db->count++];
+}
+
+static uint16_t opcodeAt(const chip8 *c8, int address) {
+    return (c8->mainMemory[address & 0xFFF] << 8) | c8->mainMemory[(address + 1) & 0xFFF];
+}
+
+void romAnalyse(const chip8 *c8, romEntry *entry) {
+    //follow every path from the rom start: jumps, both sides of skips, calls (assumed to return), stopping at returns and BNNN
+    uint8_t reached[CHIP8_MEMORY_SIZE]; //1 if an instruction starts here
+    uint16_t work[CHIP8_MEMORY_SIZE];
+    int pending = 0;
+    memset(reached, 0, sizeof(reached));
+    work[pending++] = CHIP8_ROM_START;
+    while (pending > 0) {
+        int address = work[--pending];
+        while (address >= CHIP8_ROM_START && address <= CHIP8_MEMORY_SIZE - 2 && !reached[address]) {
+            reached[address] = 1;
+            uint16_t opcode = opcodeAt(c8, address);
+            int next = address + 2;
+            int other = -1; //second place execution can go
+            switch (opcode >> 12) {
+                case 0x0:
+                    if (opcode == 0x00EE) next = -1;
+                    break;
+                case 0x1:
+                    next = opcode & 0x0FFF;
+                    break;
+                case 0x2:
+                    other = opcode & 0x0FFF;
+                    break;
+                case 0x3: case 0x4: case 0x5: case 0x9:
+                    other = address + 4;
+                    break;
+                case 0xB:
+                    next = -1; //target depends on V0
+                    break;
+                case 0xE:
+                    other = address + 4;
+                    break;
+            }
+            if (other >= 0 && pending < CHIP8_MEMORY_SIZE) work[pending++] = other;
+            if (next < 0) break;
+            address = next;
+        }
+    }
+
+    entry->rangeCount = 0;
+    entry->idleCount = 0;
+    for (int address = CHIP8_ROM_START; address < CHIP8_MEMORY_SIZE; address++) {
+        if (!reached[address]) continue;
+        codeRange *last = entry->rangeCount ? &entry->ranges[entry->rangeCount - 1] : NULL;
+        if (last && (address <= last->end + 1 || entry->rangeCount == ROMDB_MAX_RANGES)) {
+            last->end = address + 1; //carries on from the last instruction, or out of ranges so everything goes on the end
+        } else {
+            entry->ranges[entry->rangeCount].start = address;
+            entry->ranges[entry->rangeCount].end = address + 1;
+            entry->rangeCount++;
+        }
+        if (entry->idleCount < ROMDB_MAX_IDLE && !(address & 1) && idleLoopAt(c8, address)) {
+            entry->idleLoops[entry->idleCount++] = address;
+        }
+    }
+}
+
+void romApply(chip8 *c8, const romEntry *entry) {
+    c8->loadStoreRegQuirk = entry->loadStoreRegQuirk;
+    c8->spriteWrapClipQuirk = entry->spriteWrapClipQuirk;
+    c8->bitShiftQuirk = entry->bitShiftQuirk;
+    selectInterpreter(c8);
+    markIdleLoops(c8, entry->idleLoops, entry->idleCount); //before warming so predecode doesn't search those loops again
+    for (int r = 0; r < entry->rangeCount; r++) {
+        warmDecodedCache(c8, entry->ranges[r].start, entry->ranges[r].end);
+    }
+}
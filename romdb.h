@@ -0,0 +1,56 @@
+#ifndef CHIP8_ROMDB_H
+#define CHIP8_ROMDB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+// Database of known roms, keyed by a hash of the rom bytes so renamed copies are still found
+// each rom keeps the quirk flags and instruction rate it needs, and what static analysis found in it
+// (which addresses are reachable code and which loops are timer or key polling) so it's only worked out the first time it's loaded.
+// The file is text, one rom per line:
+//   hash              quirks  hz    name      code=start-end,...  idle=address,...
+//   9c4d1a25e03b8f6e  cs      700   Pong.ch8  code=200-2F5        idle=2A4
+// quirks are any of l (loadStoreRegQuirk), c (spriteWrapClipQuirk), s (bitShiftQuirk), or - for none, like the fleet job file
+// lines starting with # are ignored
+
+#define ROMDB_FILE "romdb.txt"
+#define ROMDB_MAX_RANGES 32 //code ranges kept per rom, more get merged into the last one
+#define ROMDB_MAX_IDLE 16 //idle loops kept per rom
+
+typedef struct {
+    uint16_t start;
+    uint16_t end; //last byte of the last instruction
+} codeRange;
+
+typedef struct {
+    uint64_t hash;
+    char name[64]; //file name it was first seen as, just so the file can be read
+    int loadStoreRegQuirk;
+    int spriteWrapClipQuirk;
+    int bitShiftQuirk;
+    int instructionHz;
+    int rangeCount;
+    codeRange ranges[ROMDB_MAX_RANGES];
+    int idleCount;
+    uint16_t idleLoops[ROMDB_MAX_IDLE]; //addresses of the 1NNN closing each one
+} romEntry;
+
+typedef struct {
+    romEntry *entries;
+    int count;
+    int capacity;
+} romDatabase;
+
+uint64_t romHash(const uint8_t *rom, size_t size); //64 bit FNV-1a of the rom bytes
+
+int romdbLoad(romDatabase *db, const char *path); //returns 0 on success, -1 if the file couldn't be read (db is left empty, a new file is made on save)
+int romdbSave(const romDatabase *db, const char *path); //returns 0 on success, -1 if the file couldn't be written
+void romdbFree(romDatabase *db);
+romEntry *romdbFind(romDatabase *db, uint64_t hash); //NULL if not known
+romEntry *romdbAdd(romDatabase *db, const romEntry *entry); //copy entry in, returns where it went or NULL if out of memory, pointers from earlier calls may move
+
+void romAnalyse(const chip8 *c8, romEntry *entry); //fill in the code ranges and idle loops of the rom loaded in c8
+void romApply(chip8 *c8, const romEntry *entry); //set the quirks, mark the known idle loops and predecode the known code, call after the rom is loaded
+
+#endif
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h> //stop cleanly on ctrl-c so UNIX sockets are removed
+#include <time.h> //frame pacing
+#include "chip8.h"
+#include "stream.h" //display out, keys in
+#include "romdb.h" //quirks and rate for known roms
+
+// Headless display server, runs roms in real time with no window and streams each one's display (see stream.h) so a
+// dashboard can watch and play any number of them. All the machines and their sockets are run from one thread,
+// 60 frames a second, with non-blocking I/O so a slow viewer only ever misses frames.
+//   -p port    rom N (from 0) streams on TCP 127.0.0.1 port + N (default 7000)
+//   -u prefix  rom N streams on the UNIX socket <prefix>N.sock instead
+//   -hz N      instructions per second for roms not in romdb.txt (default 600), known roms use their own rate and quirks
+// gcc -O2 serve.c stream.c snapshot.c romdb.c chip8.c -o serve
+
+typedef struct {
+    chip8 machine;
+    streamServer stream;
+    int instructionHz;
+    long remainder; //instructions owed carried from frame to frame, in 60ths
+} servedRom;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static int loadRom(servedRom *r, const char *name, romDatabase *db, int defaultHz) {
+    chip8 *c8 = &r->machine;
+    uint8_t buffer[CHIP8_MAX_ROM_SIZE + 1];
+    FILE *rom = fopen(name, "rb");
+    if (rom == NULL) {
+        return -1;
+    }
+    size_t size = fread(buffer, 1, sizeof(buffer), rom); //one extra byte so too large roms can be detected
+    fclose(rom);
+    initialiseSystem(c8);
+    if (loadROMBuffer(c8, buffer, size) != 0) {
+        return -1;
+    }
+    r->instructionHz = defaultHz;
+    romEntry *e = romdbFind(db, romHash(buffer, size));
+    if (e) {
+        romApply(c8, e);
+        r->instructionHz = e->instructionHz;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int port = 7000;
+    const char *prefix = NULL;
+    int defaultHz = 600;
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (strcmp(argv[i], "-hz") == 0 && i + 1 < argc) {
+            defaultHz = atoi(argv[++i]);
+            if (defaultHz < 1) defaultHz = 1;
+        } else {
+            first = i; //roms from here on
+            break;
+        }
+    }
+    int count = argc - first;
+    if (count <= 0) {
+        fprintf(stderr, "Usage: %s [-p port | -u prefix] [-hz N] rom...\n", argv[0]);
+        return 1;
+    }
+
+    romDatabase db;
+    romdbLoad(&db, ROMDB_FILE); //fine if there isn't one, every rom gets the defaults
+    servedRom *roms = calloc(count, sizeof(servedRom)); //machines and client queues are too big for the stack
+    if (roms == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    int opened = 0;
+    for (int i = 0; i < count; i++) {
+        const char *name = argv[first + i];
+        char address[256];
+        if (prefix) {
+            snprintf(address, sizeof(address), "%s%d.sock", prefix, i);
+        } else {
+            snprintf(address, sizeof(address), "%d", port + i);
+        }
+        if (loadRom(&roms[i], name, &db, defaultHz) != 0) {
+            fprintf(stderr, "Failed to load %s\n", name);
+            roms[i].stream.listenFd = -1;
+            continue;
+        }
+        if (streamOpen(&roms[i].stream, address) != 0) {
+            continue; //streamOpen said why
+        }
+        printf("%s on %s at %d Hz\n", name, address, roms[i].instructionHz);
+        opened++;
+    }
+    romdbFree(&db);
+    if (opened == 0) {
+        free(roms);
+        return 1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN); //viewers that go away are a send error, not a dead server
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (running) {
+        for (int i = 0; i < count; i++) {
+            servedRom *r = &roms[i];
+            if (r->stream.listenFd < 0) continue;
+            chip8 *c8 = &r->machine;
+            uint8_t keys[STREAM_MAX_KEYS];
+            int n = streamPoll(&r->stream, c8, keys, STREAM_MAX_KEYS);
+            for (int k = 0; k < n; k++) {
+                setKey(c8, keys[k] & 0xF, keys[k] >= STREAM_KEY_DOWN);
+            }
+            r->remainder += r->instructionHz; //spread the rate over 60 frames, remainder carried so odd rates come out exact
+            stepInstructions(c8, (int)(r->remainder / 60));
+            r->remainder %= 60;
+            tickTimers(c8);
+            streamFrame(&r->stream, c8);
+        }
+        next.tv_nsec += 1000000000L / 60;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long wait = (next.tv_sec - now.tv_sec) * 1000000000LL + (next.tv_nsec - now.tv_nsec);
+        if (wait > 0) {
+            struct timespec sleep = { (time_t)(wait / 1000000000LL), (long)(wait % 1000000000LL) };
+            nanosleep(&sleep, NULL); //a signal cuts it short, the loop then sees running
+        } else if (wait < -1000000000LL / 4) {
+            next = now; //fell a long way behind (machine was suspended), don't try to catch up
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        streamClose(&roms[i].stream);
+    }
+    free(roms);
+    return 0;
+}
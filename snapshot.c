@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+static const uint8_t snapshotMagic[4] = { 'C', '8', 'S', 'N' };
+#define SNAPSHOT_HEADER_SIZE 12 //magic, u16 version, u16 reserved, u32 state size
+
+static uint8_t *put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; return p + 2; }
+static uint8_t *put32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; return p + 4; }
+static uint8_t *put64(uint8_t *p, uint64_t v) { put32(p, (uint32_t)v); return put32(p + 4, (uint32_t)(v >> 32)); }
+static uint16_t get16(const uint8_t *p) { return p[0] | p[1] << 8; }
+static uint32_t get32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint64_t get64(const uint8_t *p) { return get32(p) | (uint64_t)get32(p + 4) << 32; }
+
+void saveState(const chip8 *c8, uint8_t *state) {
+    uint8_t *p = state;
+    memcpy(p, c8->mainMemory, CHIP8_MEMORY_SIZE);
+    p += CHIP8_MEMORY_SIZE;
+    memcpy(p, c8->regs.V, 16); //23 bytes of registers
+    p += 16;
+    p = put16(p, c8->regs.I);
+    *p++ = c8->regs.DT;
+    *p++ = c8->regs.ST;
+    p = put16(p, c8->regs.PC);
+    *p++ = c8->regs.SP;
+    for (int i = 0; i < 16; i++) {
+        p = put16(p, c8->stack[i]);
+    }
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        for (int y = 0; y < CHIP8_HIRES_HEIGHT; y++) {
+            for (int w = 0; w < CHIP8_ROW_WORDS; w++) {
+                p = put64(p, c8->display[plane][y][w]);
+            }
+        }
+    }
+    memcpy(p, c8->keys, 16);
+    p += 16;
+    *p++ = c8->loadStoreRegQuirk != 0;
+    *p++ = c8->spriteWrapClipQuirk != 0;
+    *p++ = c8->bitShiftQuirk != 0;
+    p = put32(p, c8->rngState);
+    *p++ = c8->keyWait;
+    *p++ = c8->keyWaitRegister;
+    *p++ = c8->keyWaitKey;
+    p = put16(p, c8->keyWaitHeld);
+    *p++ = c8->hires;
+    *p++ = c8->planes;
+    memcpy(p, c8->flags, 16);
+}
+
+void loadState(chip8 *c8, const uint8_t *state) {
+    const uint8_t *p = state;
+    memcpy(c8->mainMemory, p, CHIP8_MEMORY_SIZE);
+    p += CHIP8_MEMORY_SIZE;
+    memcpy(c8->regs.V, p, 16);
+    p += 16;
+    c8->regs.I = get16(p); p += 2;
+    c8->regs.DT = *p++;
+    c8->regs.ST = *p++;
+    c8->regs.PC = get16(p); p += 2;
+    c8->regs.SP = *p++ & 0xF; //stack only has 16 entries, don't trust the file
+    for (int i = 0; i < 16; i++) {
+        c8->stack[i] = get16(p);
+        p += 2;
+    }
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        for (int y = 0; y < CHIP8_HIRES_HEIGHT; y++) {
+            for (int w = 0; w < CHIP8_ROW_WORDS; w++) {
+                c8->display[plane][y][w] = get64(p);
+                p += 8;
+            }
+        }
+    }
+    c8->displayGeneration++; //whole display replaced
+    memcpy(c8->keys, p, 16);
+    p += 16;
+    c8->loadStoreRegQuirk = *p++;
+    c8->spriteWrapClipQuirk = *p++;
+    c8->bitShiftQuirk = *p++;
+    c8->rngState = get32(p); p += 4;
+    if (c8->rngState == 0) c8->rngState = 1; //xorshift gets stuck on 0
+    c8->keyWait = *p++;
+    if (c8->keyWait > CHIP8_KEY_WAIT_RELEASE) c8->keyWait = 0;
+    c8->keyWaitRegister = *p++ & 0xF;
+    c8->keyWaitKey = *p++ & 0xF;
+    c8->keyWaitHeld = get16(p); p += 2;
+    c8->hires = *p++ != 0;
+    c8->planes = *p++ & ((1 << CHIP8_PLANES) - 1);
+    memcpy(c8->flags, p, 16);
+    c8->lastInstruction = 0;
+    flushDecodedCache(c8); //memory is all new
+    selectInterpreter(c8); //and the quirks may be too
+}
+
+int saveSnapshotFile(const chip8 *c8, const char *path) {
+    uint8_t buffer[SNAPSHOT_HEADER_SIZE + CHIP8_STATE_SIZE];
+    memcpy(buffer, snapshotMagic, 4);
+    put16(buffer + 4, CHIP8_SNAPSHOT_VERSION);
+    put16(buffer + 6, 0);
+    put32(buffer + 8, CHIP8_STATE_SIZE);
+    saveState(c8, buffer + SNAPSHOT_HEADER_SIZE);
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    size_t written = fwrite(buffer, 1, sizeof(buffer), f);
+    if (fclose(f) != 0 || written != sizeof(buffer)) {
+        return -1;
+    }
+    return 0;
+}
+
+int loadSnapshotFile(chip8 *c8, const char *path) {
+    uint8_t buffer[SNAPSHOT_HEADER_SIZE + CHIP8_STATE_SIZE];
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    size_t got = fread(buffer, 1, sizeof(buffer), f);
+    fclose(f);
+    if (got < SNAPSHOT_HEADER_SIZE || memcmp(buffer, snapshotMagic, 4) != 0) {
+        fprintf(stderr, "%s is not a chip8 snapshot\n", path);
+        return -1;
+    }
+    if (get16(buffer + 4) != CHIP8_SNAPSHOT_VERSION || get32(buffer + 8) != CHIP8_STATE_SIZE || got != sizeof(buffer)) {
+        fprintf(stderr, "%s is snapshot version %d, this build reads version %d\n", path, get16(buffer + 4), CHIP8_SNAPSHOT_VERSION);
+        return -1;
+    }
+    loadState(c8, buffer + SNAPSHOT_HEADER_SIZE);
+    return 0;
+}
+
+// Delta encoding: XOR of two states is mostly zero bytes, stored as tokens of
+// [u16 zero bytes to skip][u16 literal length][literal XOR bytes]
+// a literal only ends at a run of at least MIN_ZERO_RUN zeros so a token always covers more bytes than it takes up,
+// which keeps the worst case at size + 4
+#define MIN_ZERO_RUN 4
+
+size_t encodeDelta(const uint8_t *from, const uint8_t *to, size_t size, uint8_t *out) {
+    size_t i = 0, n = 0;
+    while (i < size) {
+        size_t zeroStart = i;
+        while (i < size && from[i] == to[i]) i++;
+        if (i == size) break; //trailing zeros don't need a token
+        size_t literalStart = i, literalEnd = i;
+        while (i < size) {
+            if (from[i] != to[i]) {
+                literalEnd = ++i;
+                continue;
+            }
+            size_t run = i;
+            while (run < size && from[run] == to[run] && run - i < MIN_ZERO_RUN) run++;
+            if (run - i >= MIN_ZERO_RUN || run == size) break; //long enough gap (or the end), finish this literal
+            i = run; //short gap, keep it in the literal
+        }
+        i = literalEnd;
+        put16(out + n, (uint16_t)(literalStart - zeroStart));
+        put16(out + n + 2, (uint16_t)(literalEnd - literalStart));
+        n += 4;
+        for (size_t j = literalStart; j < literalEnd; j++) {
+            out[n++] = from[j] ^ to[j];
+        }
+    }
+    return n;
+}
+
+void applyDelta(uint8_t *state, const uint8_t *delta, size_t length) { //XOR is its own inverse, same delta goes either way
+    size_t i = 0, n = 0;
+    while (n + 4 <= length) {
+        i += get16(delta + n);
+        uint16_t literal = get16(delta + n + 2);
+        n += 4;
+        for (uint16_t j = 0; j < literal; j++) {
+            state[i++] ^= delta[n++];
+        }
+    }
+}
+
+int rewindInit(rewindBuffer *rb, size_t arenaSize) {
+    if (arenaSize < REWIND_MAX_DELTA_SIZE) arenaSize = REWIND_MAX_DELTA_SIZE; //always room for at least one
+    rb->arena = malloc(arenaSize);
+    if (rb->arena == NULL) {
+        return -1;
+    }
+    rb->arenaSize = arenaSize;
+    rewindClear(rb);
+    return 0;
+}
+
+void rewindFree(rewindBuffer *rb) {
+    free(rb->arena);
+    rb->arena = NULL;
+}
+
+void rewindClear(rewindBuffer *rb) {
+    rb->hasCurrent = 0;
+    rb->head = 0;
+    rb->first = 0;
+    rb->count = 0;
+    rb->bytesUsed = 0;
+}
+
+static void dropOldest(rewindBuffer *rb) {
+    rb->bytesUsed -= rb->length[rb->first];
+    rb->first = (rb->first + 1) % REWIND_MAX_FRAMES;
+    rb->count--;
+}
+
+void rewindPush(rewindBuffer *rb, const chip8 *c8) {
+    uint8_t *state = rb->scratchState;
+    uint8_t *delta = rb->scratchDelta;
+    saveState(c8, state);
+    if (!rb->hasCurrent) { //first frame, nothing to diff against
+        memcpy(rb->current, state, CHIP8_STATE_SIZE);
+        rb->hasCurrent = 1;
+        return;
+    }
+    size_t length = encodeDelta(rb->current, state, CHIP8_STATE_SIZE, delta);
+    memcpy(rb->current, state, CHIP8_STATE_SIZE);
+
+    if (rb->count == REWIND_MAX_FRAMES) dropOldest(rb);
+    size_t at = rb->head;
+    if (at + length > rb->arenaSize) { //doesn't fit before the end, wrap, anything still in the skipped tail is the oldest
+        while (rb->count > 0 && rb->offset[rb->first] >= at) dropOldest(rb);
+        at = 0;
+    }
+    while (rb->count > 0 && rb->offset[rb->first] < at + length && at < rb->offset[rb->first] + rb->length[rb->first]) { //oldest deltas are the ones just after head
+        dropOldest(rb);
+    }
+    memcpy(rb->arena + at, delta, length);
+    int slot = (rb->first + rb->count) % REWIND_MAX_FRAMES;
+    rb->offset[slot] = (uint32_t)at;
+    rb->length[slot] = (uint16_t)length;
+    rb->count++;
+    rb->bytesUsed += length;
+    rb->head = at + length;
+}
+
+int rewindStep(rewindBuffer *rb, chip8 *c8) {
+    if (rb->count == 0) {
+        return -1;
+    }
+    int newest = (rb->first + rb->count - 1) % REWIND_MAX_FRAMES;
+    applyDelta(rb->current, rb->arena + rb->offset[newest], rb->length[newest]);
+    rb->bytesUsed -= rb->length[newest];
+    rb->head = rb->offset[newest]; //space is free again
+    rb->count--;
+    loadState(c8, rb->current);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef CHIP8_SNAPSHOT_H
+#define CHIP8_SNAPSHOT_H
+
+#include "chip8.h"
+
+// Machine state snapshots, a flat little endian byte layout so files work across compilers and platforms
+// state is memory, registers, stack, display planes, keys, quirk flags, the random number state, whether FX0A is waiting,
+// the display mode and selected planes, and the RPL flags
+// files are a small header (magic, version, state size) followed by the state bytes
+
+#define CHIP8_SNAPSHOT_VERSION 3 //bump when the state layout changes
+#define CHIP8_STATE_SIZE (CHIP8_MEMORY_SIZE + 23 + 16 * 2 + CHIP8_PLANES * CHIP8_HIRES_HEIGHT * CHIP8_ROW_WORDS * 8 + 16 + 3 + 4 + 5 + 2 + 16)
+
+void saveState(const chip8 *c8, uint8_t *state); //write CHIP8_STATE_SIZE bytes
+void loadState(chip8 *c8, const uint8_t *state); //read CHIP8_STATE_SIZE bytes back into the machine
+int saveSnapshotFile(const chip8 *c8, const char *path); //returns 0 on success, -1 if the file couldn't be written
+int loadSnapshotFile(chip8 *c8, const char *path); //returns 0 on success, -1 if missing, not a snapshot or a different version (machine is left alone)
+
+// XOR delta between two buffers, run length encoded as tokens of [u16 bytes to skip][u16 literal length][literal XOR bytes]
+// (little endian), used for rewind and the display stream. Identical buffers encode to nothing, the worst case is size + 4 bytes.
+size_t encodeDelta(const uint8_t *from, const uint8_t *to, size_t size, uint8_t *out); //returns the encoded length, size must be under 64k
+void applyDelta(uint8_t *data, const uint8_t *delta, size_t length); //XOR the delta into data, turns from into to and to back into from
+
+// Rewind, keeps the last REWIND_MAX_FRAMES states as XOR deltas between one frame and the next, run length encoded.
+// Most of the machine doesn't change from one frame to the next so a delta is usually tens of bytes.
+// The newest state is kept whole, stepping back XORs the newest delta into it.
+#define REWIND_MAX_FRAMES 600 //10 seconds at 60 frames a second
+#define REWIND_MAX_DELTA_SIZE (CHIP8_STATE_SIZE + 8) //worst case encoded delta
+
+typedef struct {
+    uint8_t current[CHIP8_STATE_SIZE]; //newest state pushed
+    uint8_t scratchState[CHIP8_STATE_SIZE]; //state and delta being pushed, kept here so pushes don't need 12k of stack
+    uint8_t scratchDelta[REWIND_MAX_DELTA_SIZE];
+    int hasCurrent;
+    uint8_t *arena; //deltas back to back, wraps around
+    size_t arenaSize;
+    size_t head; //where the next delta goes in arena
+    uint32_t offset[REWIND_MAX_FRAMES]; //ring of deltas, oldest at first
+    uint16_t length[REWIND_MAX_FRAMES];
+    int first;
+    int count;
+    size_t bytesUsed; //total size of the deltas held
+} rewindBuffer;
+
+int rewindInit(rewindBuffer *rb, size_t arenaSize); //returns 0 on success, -1 if out of memory
+void rewindFree(rewindBuffer *rb);
+void rewindClear(rewindBuffer *rb); //forget everything, e.g. a new rom was loaded
+void rewindPush(rewindBuffer *rb, const chip8 *c8); //record the machine as it is now, call once a frame
+int rewindStep(rewindBuffer *rb, chip8 *c8); //put the machine back one frame, returns 0 on success, -1 if there's nothing older
+
+#endif
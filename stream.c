@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h> //O_NONBLOCK
+#include <netinet/in.h>
+#include <netinet/tcp.h> //TCP_NODELAY, frames are small and late ones are worse than extra packets
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "stream.h"
+#include "snapshot.h" //encodeDelta
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL) //a viewer that went away is an error return, not SIGPIPE
+#else
+#define SEND_FLAGS MSG_DONTWAIT
+#endif
+
+static void packDisplay(const chip8 *c8, uint8_t *out) { //each word big endian so bytes read left to right
+    for (int plane = 0; plane < CHIP8_PLANES; plane++) {
+        for (int y = 0; y < CHIP8_HIRES_HEIGHT; y++) {
+            for (int w = 0; w < CHIP8_ROW_WORDS; w++) {
+                uint64_t word = c8->display[plane][y][w];
+                for (int b = 0; b < 8; b++) {
+                    *out++ = (uint8_t)(word >> (56 - 8 * b));
+                }
+            }
+        }
+    }
+}
+
+static int queueBytes(streamClient *client, const uint8_t *data, size_t length) { //all or nothing, returns -1 if there isn't room
+    if (length > STREAM_QUEUE_SIZE - client->length) {
+        return -1;
+    }
+    size_t tail = (client->head + client->length) % STREAM_QUEUE_SIZE;
+    for (size_t i = 0; i < length; i++) {
+        client->queue[(tail + i) % STREAM_QUEUE_SIZE] = data[i];
+    }
+    client->length += length;
+    return 0;
+}
+
+#ifndef _WIN32
+static void dropClient(streamClient *client) {
+    close(client->fd);
+    client->fd = -1;
+}
+
+static void flushClient(streamClient *client) { //send as much of the queue as the socket takes right now
+    while (client->length > 0) {
+        size_t chunk = STREAM_QUEUE_SIZE - client->head; //up to the end of the ring
+        if (chunk > client->length) chunk = client->length;
+        ssize_t n = send(client->fd, client->queue + client->head, chunk, SEND_FLAGS);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) dropClient(client);
+            return;
+        }
+        client->head = (client->head + n) % STREAM_QUEUE_SIZE;
+        client->length -= n;
+    }
+}
+#endif
+
+static void sendFrame(streamServer *s, streamClient *client) { //delta from what the client has to the current display
+    uint8_t *frame = s->scratch;
+    size_t length = encodeDelta(client->display, s->display, STREAM_DISPLAY_SIZE, frame + STREAM_FRAME_HEADER);
+    if (length == 0 && client->hires == s->hires) {
+        client->frame = s->frame;
+        client->behind = 0; //already has it
+        return;
+    }
+    frame[0] = s->frame;
+    frame[1] = s->frame >> 8;
+    frame[2] = s->frame >> 16;
+    frame[3] = s->frame >> 24;
+    frame[4] = s->hires ? 1 : 0;
+    frame[5] = length;
+    frame[6] = length >> 8;
+    if (queueBytes(client, frame, STREAM_FRAME_HEADER + length) != 0) {
+        client->dropped++; //too far behind, catch up from wherever it is next time there's room
+        client->behind = 1;
+        return;
+    }
+    memcpy(client->display, s->display, STREAM_DISPLAY_SIZE);
+    client->hires = s->hires;
+    client->frame = s->frame;
+    client->behind = 0;
+}
+
+static void updateDisplay(streamServer *s, const chip8 *c8) { //bring s->display up to date, only repacked (and a new frame) if the machine drew
+    if (c8->displayGeneration == s->generation && c8->hires == s->hires) return;
+    packDisplay(c8, s->display);
+    s->frame++; //whichever of streamPoll and streamFrame noticed, every client not sent this one is now behind it
+    s->generation = c8->displayGeneration;
+    s->hires = c8->hires;
+}
+
+#ifdef _WIN32
+int streamOpen(streamServer *s, const char *address) {
+    (void)address;
+    s->listenFd = -1;
+    printf("Display streaming isn't supported on Windows\n");
+    return -1;
+}
+
+int streamPoll(streamServer *s, const chip8 *c8, uint8_t *keys, int max) {
+    (void)s; (void)c8; (void)keys; (void)max;
+    return 0;
+}
+
+void streamClose(streamServer *s) {
+    (void)s;
+}
+#else
+static int listenUnix(streamServer *s, const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("Stream socket path is too long: %s\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    struct stat info;
+    if (lstat(path, &info) == 0) { //left over from a run that didn't close it, only ever replace a socket
+        if (!S_ISSOCK(info.st_mode)) {
+            printf("%s exists and isn't a socket, not replacing it\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        printf("Failed to open stream socket %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    strcpy(s->path, path);
+    return fd;
+}
+
+static int listenTcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("Failed to create stream socket: %s\n", strerror(errno));
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)); //restarting straight away shouldn't need a new port
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); //local viewers only
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        printf("Failed to open stream port %d: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int streamOpen(streamServer *s, const char *address) {
+    memset(s, 0, sizeof(*s));
+    s->listenFd = -1;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) s->clients[i].fd = -1;
+    s->generation = 0;
+    s->hires = -1; //packed display is out of date until the first frame
+    int isPort = address[0] != '\0' && strspn(address, "0123456789") == strlen(address);
+    int fd = isPort ? listenTcp(atoi(address)) : listenUnix(s, address);
+    if (fd < 0) {
+        return -1;
+    }
+    if (listen(fd, STREAM_MAX_CLIENTS) != 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        printf("Failed to listen on %s: %s\n", address, strerror(errno));
+        close(fd);
+        if (s->path[0]) unlink(s->path);
+        return -1;
+    }
+    s->listenFd = fd;
+    return 0;
+}
+
+static void acceptClients(streamServer *s) {
+    for (;;) {
+        int fd = accept(s->listenFd, NULL, NULL);
+        if (fd < 0) return; //EAGAIN, nobody else waiting
+        int i = 0;
+        while (i < STREAM_MAX_CLIENTS && s->clients[i].fd >= 0) i++;
+        if (i == STREAM_MAX_CLIENTS) {
+            close(fd); //full, try again later
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); //fails harmlessly on a UNIX socket
+        streamClient *client = &s->clients[i];
+        client->fd = fd;
+        client->head = 0;
+        client->length = 0;
+        client->dropped = 0;
+        client->behind = 1; //gets the whole display straight away
+        client->hires = -1; //and a first frame even if it's blank
+        memset(client->display, 0, STREAM_DISPLAY_SIZE);
+        uint8_t hello[5] = { 'C', '8', 'S', 'T', STREAM_VERSION };
+        queueBytes(client, hello, sizeof(hello));
+    }
+}
+
+static int readKeys(streamClient *client, uint8_t *keys, int max) { //returns how many key events went into keys
+    uint8_t bytes[64];
+    int count = 0;
+    while (count < max) {
+        size_t want = max - count < (int)sizeof(bytes) ? (size_t)(max - count) : sizeof(bytes); //never read more than there's room for
+        ssize_t n = recv(client->fd, bytes, want, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            dropClient(client); //viewer closed
+            return count;
+        }
+        if (n < 0) return count;
+        for (ssize_t i = 0; i < n; i++) {
+            if (bytes[i] < STREAM_KEY_DOWN + 16) keys[count++] = bytes[i];
+        }
+    }
+    return count;
+}
+
+int streamPoll(streamServer *s, const chip8 *c8, uint8_t *keys, int max) {
+    if (s->listenFd < 0) return 0;
+    acceptClients(s);
+    int count = 0;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        streamClient *client = &s->clients[i];
+        if (client->fd < 0) continue;
+        count += readKeys(client, keys + count, max - count);
+        if (client->fd < 0) continue;
+        if (client->behind) { //new, or missed a frame, catch it up now rather than waiting for the display to change
+            updateDisplay(s, c8);
+            sendFrame(s, client);
+        }
+        flushClient(client);
+    }
+    return count;
+}
+
+void streamClose(streamServer *s) {
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (s->clients[i].fd >= 0) dropClient(&s->clients[i]);
+    }
+    if (s->listenFd >= 0) {
+        close(s->listenFd);
+        s->listenFd = -1;
+        if (s->path[0]) unlink(s->path);
+    }
+}
+#endif
+
+void streamFrame(streamServer *s, const chip8 *c8) {
+    if (s->listenFd < 0) return;
+    updateDisplay(s, c8);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        streamClient *client = &s->clients[i];
+        if (client->fd < 0 || (client->frame == s->frame && !client->behind)) continue;
+        sendFrame(s, client);
+#ifndef _WIN32
+        flushClient(client);
+#endif
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef CHIP8_STREAM_H
+#define CHIP8_STREAM_H
+
+#include <stdint.h>
+#include "chip8.h"
+
+// Display streaming server, lets a dashboard watch and play any number of machines (headless or not) over a local
+// TCP port or UNIX domain socket. Everything is non-blocking and each client has a bounded send queue, so a slow or
+// stuck viewer just misses frames and never holds up the machine.
+//
+// Protocol, all numbers little endian:
+//   server sends "C8ST" and a version byte on connect, then a frame straight away and whenever the display changed:
+//     u32 frame number (goes up by one for each display change the server saw, a gap means frames were skipped), u8 flags (1 hires), u16 delta length, delta
+//   the delta is encodeDelta() (snapshot.h) from the display the client had to the new one, the first frame is from all zeros and may have an empty delta.
+//   The display is STREAM_DISPLAY_SIZE bytes: CHIP8_PLANES planes of CHIP8_HIRES_HEIGHT rows of 16 bytes, leftmost pixel in
+//   the top bit of each row's first byte, lores only uses the first 8 bytes of the first 32 rows.
+//   Frames the client's queue had no room for are skipped, the next delta is from whatever the client was last sent.
+//   client sends single bytes: 00-0F key up, 10-1F key down (low 4 bits are the key, same as recordings), anything else is ignored
+
+#define STREAM_MAGIC "C8ST"
+#define STREAM_VERSION 1
+#define STREAM_DISPLAY_SIZE (CHIP8_PLANES * CHIP8_HIRES_HEIGHT * CHIP8_ROW_WORDS * 8)
+#define STREAM_FRAME_HEADER 7
+#define STREAM_MAX_FRAME (STREAM_FRAME_HEADER + STREAM_DISPLAY_SIZE + 4) //worst case delta
+#define STREAM_QUEUE_SIZE (4 * STREAM_MAX_FRAME) //bytes waiting to go to one client, a few frames behind is as far as it gets
+#define STREAM_MAX_CLIENTS 16
+#define STREAM_MAX_KEYS 64 //key events worth passing to streamPoll at once, more wait for the next call
+#define STREAM_KEY_UP 0x00
+#define STREAM_KEY_DOWN 0x10
+
+typedef struct {
+    int fd; //-1 if the slot is free
+    uint8_t queue[STREAM_QUEUE_SIZE]; //ring of bytes not sent yet
+    size_t head, length;
+    uint8_t display[STREAM_DISPLAY_SIZE]; //what the client will have once everything queued arrives
+    int hires; //mode it was last sent, a switch is sent even when no pixels changed
+    uint32_t frame; //frame number it was last sent, streamFrame sends it the display whenever that isn't the current one
+    uint64_t dropped; //frames skipped because the queue was full
+    int behind; //new or missed a frame, gets one as soon as there's room whether the display changed or not
+} streamClient;
+
+typedef struct {
+    int listenFd; //-1 when closed
+    char path[108]; //UNIX socket to remove on close, empty for TCP
+    uint32_t frame;
+    uint32_t generation; //displayGeneration when the display was last packed
+    int hires;
+    uint8_t display[STREAM_DISPLAY_SIZE]; //packed current display
+    uint8_t scratch[STREAM_MAX_FRAME];
+    streamClient clients[STREAM_MAX_CLIENTS];
+} streamServer;
+
+int streamOpen(streamServer *s, const char *address); //address is a port number (TCP on 127.0.0.1) or a path (UNIX socket), returns 0 on success, -1 on failure
+int streamPoll(streamServer *s, const chip8 *c8, uint8_t *keys, int max); //call often, accepts clients, catches up ones that are behind, sends what the sockets will take and reads key events into keys (STREAM_KEY_UP/DOWN | key), returns how many, never blocks
+void streamFrame(streamServer *s, const chip8 *c8); //call once a frame after tickTimers, queues the display for every client it changed for
+void streamClose(streamServer *s);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h> //sched_yield
+#include <time.h> //nanosleep
+#include "trace.h"
+
+static void writerSleep() { //nothing to write, check again in a millisecond
+    struct timespec ts = { 0, 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+static void writeRecords(struct chip8Trace *t) { //write everything between head and tail, in at most two pieces since the ring wraps
+    uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&t->tail, memory_order_acquire);
+    while (head != tail) {
+        uint64_t start = head & (TRACE_RING_SIZE - 1);
+        uint64_t count = tail - head;
+        if (start + count > TRACE_RING_SIZE) count = TRACE_RING_SIZE - start; //up to the end of the ring this time round
+        fwrite(&t->ring[start], sizeof(traceRecord), count, t->file);
+        head += count;
+        atomic_store_explicit(&t->head, head, memory_order_release); //machine can reuse those records now
+    }
+}
+
+static void *writerMain(void *arg) {
+    struct chip8Trace *t = arg;
+    while (atomic_load(&t->running)) {
+        if (atomic_load_explicit(&t->tail, memory_order_acquire) == atomic_load_explicit(&t->head, memory_order_relaxed)) {
+            writerSleep();
+            continue;
+        }
+        writeRecords(t);
+    }
+    writeRecords(t); //whatever the machine added before traceStop
+    return NULL;
+}
+
+void traceWait(struct chip8Trace *t) {
+    t->stalls++;
+    uint64_t tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&t->head, memory_order_acquire) == TRACE_RING_SIZE) {
+        sched_yield();
+    }
+}
+
+int traceStart(chip8 *c8, const char *path) {
+    if (c8->trace) traceStop(c8);
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    struct chip8Trace *t = malloc(sizeof(struct chip8Trace));
+    if (t == NULL) {
+        fclose(f);
+        return -1;
+    }
+    traceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, 4);
+    header.version = TRACE_VERSION;
+    header.byteOrder = TRACE_BYTE_ORDER;
+    header.recordSize = sizeof(traceRecord);
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, f);
+
+    atomic_init(&t->head, 0);
+    atomic_init(&t->tail, 0);
+    t->cycle = 0;
+    t->stalls = 0;
+    atomic_init(&t->running, 1);
+    t->file = f;
+    if (pthread_create(&t->writer, NULL, writerMain, t) != 0) {
+        fclose(f);
+        free(t);
+        return -1;
+    }
+    c8->trace = t;
+    return 0;
+}
+
+void traceStop(chip8 *c8) {
+    struct chip8Trace *t = c8->trace;
+    if (t == NULL) return;
+    c8->trace = NULL; //untraced from here on
+    atomic_store(&t->running, 0);
+    pthread_join(t->writer, NULL);
+    if (t->stalls) {
+        fprintf(stderr, "Trace writer fell behind %llu times\n", (unsigned long long)t->stalls);
+    }
+    fclose(t->file);
+    free(t);
+}
@@ -0,0 +1,81 @@
+#ifndef CHIP8_TRACE_H
+#define CHIP8_TRACE_H
+
+#include <stdint.h>
+#include <stdatomic.h> //ring head/tail shared with the writer thread
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "chip8.h"
+
+// Optional instruction trace, build the core with -DCHIP8_TRACE and trace.c to get it
+// without CHIP8_TRACE none of this is compiled into the core so there's no cost at all.
+// Every instruction a traced machine runs appends a fixed size record to a preallocated ring,
+// a background thread writes the ring out to the trace file, tracedump.c turns the file back into text.
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+#define TRACE_BYTE_ORDER 0x0102 //records are written in host byte order, the decoder checks this reads back the same
+#define TRACE_RING_SIZE (1 << 16) //records, power of two, 2MB
+
+typedef struct {
+    uint64_t cycle; //instructions the machine ran before this one since tracing started
+    uint16_t PC; //where the instruction was fetched from
+    uint16_t opcode;
+    uint16_t I; //after the instruction
+    uint16_t changed; //bit n set if Vn was changed by the instruction
+    uint8_t V[16]; //registers after the instruction, only the changed ones are worth printing
+} traceRecord; //32 bytes
+
+typedef struct { //start of every trace file
+    char magic[4];
+    uint16_t version;
+    uint16_t byteOrder;
+    uint16_t recordSize;
+    uint16_t reserved;
+} traceHeader;
+
+struct chip8Trace {
+    traceRecord ring[TRACE_RING_SIZE];
+    _Atomic uint64_t head; //next record the writer takes, only written by the writer
+    _Atomic uint64_t tail; //next free record, only written by the machine's thread
+    uint64_t cycle;
+    uint64_t stalls; //times the ring was full and the machine had to wait for the writer
+    atomic_int running;
+    FILE *file;
+    pthread_t writer;
+};
+
+int traceStart(chip8 *c8, const char *path); //start tracing into path, returns 0 on success, -1 if the file can't be created
+void traceStop(chip8 *c8); //write out everything left and close the file
+
+void traceWait(struct chip8Trace *t); //ring is full, wait for the writer to make room
+
+static inline uint16_t traceChangedBytes(uint64_t diff) { //bit n set if byte n of diff is non zero, byte 0 is V0 on little endian hosts
+    uint64_t high = ((diff & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | diff; //top bit of each byte set if any bit in it is
+    high = (high >> 7) & 0x0101010101010101ULL;
+    return (uint16_t)((high * 0x0102040810204080ULL) >> 56); //gather the 8 flags into one byte
+}
+
+static inline void traceInstruction(struct chip8Trace *t, uint16_t pc, uint16_t opcode, const uint8_t *before, const chip8 *c8) { //called by the core after each instruction
+    uint64_t tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&t->head, memory_order_acquire) == TRACE_RING_SIZE) {
+        traceWait(t);
+    }
+    traceRecord *r = &t->ring[tail & (TRACE_RING_SIZE - 1)];
+    r->cycle = t->cycle++;
+    r->PC = pc;
+    r->opcode = opcode;
+    r->I = c8->regs.I;
+    uint64_t lo, hi, beforeLo, beforeHi; //registers as two words so the changed mask is a few ALU ops instead of 16 compares
+    memcpy(&lo, c8->regs.V, 8);
+    memcpy(&hi, c8->regs.V + 8, 8);
+    memcpy(&beforeLo, before, 8);
+    memcpy(&beforeHi, before + 8, 8);
+    r->changed = traceChangedBytes(lo ^ beforeLo) | traceChangedBytes(hi ^ beforeHi) << 8;
+    memcpy(r->V, &lo, 8);
+    memcpy(r->V + 8, &hi, 8);
+    atomic_store_explicit(&t->tail, tail + 1, memory_order_release); //record is complete before the writer sees it
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+// Offline trace decoder, prints a trace file written by a -DCHIP8_TRACE build as one line per instruction:
+//   cycle  PC  opcode  I  registers the instruction changed
+// gcc tracedump.c -o tracedump
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s trace.c8t [out.txt]\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    FILE *out = stdout;
+    if (argc > 2) {
+        out = fopen(argv[2], "w");
+        if (out == NULL) {
+            fprintf(stderr, "Failed to open %s\n", argv[2]);
+            fclose(in);
+            return 1;
+        }
+    }
+
+    traceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, TRACE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s is not a chip8 trace\n", argv[1]);
+        return 1;
+    }
+    if (header.byteOrder != TRACE_BYTE_ORDER || header.version != TRACE_VERSION || header.recordSize != sizeof(traceRecord)) {
+        fprintf(stderr, "%s was written by a different version or byte order\n", argv[1]);
+        return 1;
+    }
+
+    static traceRecord records[4096];
+    size_t count, total = 0;
+    char line[256];
+    while ((count = fread(records, sizeof(traceRecord), 4096, in)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            traceRecord *r = &records[i];
+            int len = snprintf(line, sizeof(line), "%10llu  %03X  %04X  I=%03X", (unsigned long long)r->cycle, r->PC, r->opcode, r->I);
+            for (int v = 0; v < 16; v++) {
+                if (r->changed & (1 << v)) {
+                    len += snprintf(line + len, sizeof(line) - len, "  V%X=%02X", v, r->V[v]);
+                }
+            }
+            fprintf(out, "%s\n", line);
+        }
+        total += count;
+    }
+    fprintf(stderr, "%zu instructions\n", total);
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return 0;
+}